@@ -0,0 +1,44 @@
+#include "EmitterCheck.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include "Simulation.h"
+
+constexpr float CHECK_WIDTH = 800.0f; //  
+constexpr float CHECK_HEIGHT = 600.0f;
+constexpr int EMIT_FRAMES = 40; //    ,  5   
+constexpr int SETTLE_FRAMES = 80;
+
+bool checkEmitterStability(float maxSpeed) {
+    struct KernelCase {
+        KernelType type;
+        const char* name;
+    };
+    const KernelCase kernels[] = { { KernelType::Spiky, "spiky" }, { KernelType::Poly6, "poly6" },
+        { KernelType::WendlandC2, "wendland_c2" }, { KernelType::CubicSpline, "cubic_spline" } };
+
+    bool passed = true;
+    for (const KernelCase& kernel : kernels) {
+        Simulation simulation(CHECK_WIDTH, CHECK_HEIGHT);
+        simulation.setSolver(Simulation::Solver::DivergenceFree);
+        simulation.setKernel(kernel.type);
+
+        float peakSpeed = 0.0f;
+        bool finite = true;
+        for (int frame = 0; frame < EMIT_FRAMES + SETTLE_FRAMES; ++frame) {
+            simulation.update(1.0f / 60.0f, frame < EMIT_FRAMES, { CHECK_WIDTH * 0.5f, 100.0f });
+            const ParticleStore& p = simulation.getParticles();
+            for (size_t i = 0; i < p.size(); ++i) {
+                float speed = std::hypot(p.vx[i], p.vy[i]);
+                finite &= std::isfinite(speed);
+                if (std::isfinite(speed)) peakSpeed = std::max(peakSpeed, speed);
+            }
+        }
+
+        bool ok = finite && peakSpeed <= maxSpeed;
+        std::printf("%s: %zu particles, peak speed %.0f px/s (limit %.0f)%s %s\n", kernel.name, simulation.getParticles().size(),
+            peakSpeed, maxSpeed, finite ? "" : ", non-finite velocities", ok ? "ok" : "FAILED");
+        passed &= ok;
+    }
+    return passed;
+}
@@ -0,0 +1,10 @@
+#ifndef EMITTER_CHECK_H
+#define EMITTER_CHECK_H
+
+//   emitParticles  DFSPH    : 40   ,
+// 80       .      ,
+//  -     .
+// true -         maxSpeed
+bool checkEmitterStability(float maxSpeed);
+
+#endif
@@ -0,0 +1,109 @@
+#include "Scenarios.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+constexpr float PARTICLE_SPACING = 8.0f; //  ,  12    
+constexpr float WALL_MARGIN = 6.0f; //   ,    
+constexpr float JITTER = 0.5f; //    ,   
+constexpr float JET_SPEED = 400.0f; //  
+constexpr unsigned SCENE_SEED = 12345;
+
+static int columnsFor(int count, float aspect) {
+    //  columns x rows  rows / columns   aspect
+    return std::max(1, static_cast<int>(std::lround(std::sqrt(count / aspect))));
+}
+
+static int rowsFor(int count, int columns) {
+    return (count + columns - 1) / columns;
+}
+
+//   count    columns     (left, bottom) .
+//  y  ,   
+static void addBlock(Scene& scene, std::mt19937& rng, float left, float bottom, int columns, int count, Vec2 velocity) {
+    std::uniform_real_distribution<float> jitter(-JITTER, JITTER);
+    for (int k = 0; k < count; ++k) {
+        Particle p;
+        p.position.x = left + (k % columns) * PARTICLE_SPACING + jitter(rng);
+        p.position.y = bottom - (k / columns) * PARTICLE_SPACING + jitter(rng);
+        p.velocity = velocity;
+        p.color = Color::Blue;
+        scene.particles.push_back(p);
+    }
+}
+
+Scene buildScene(Scenario scenario, int particleCount) {
+    std::mt19937 rng(SCENE_SEED);
+    Scene scene;
+    scene.particles.reserve(particleCount);
+    float s = PARTICLE_SPACING;
+
+    switch (scenario) {
+    case Scenario::DamBreak: {
+        //       ,   
+        int columns = columnsFor(particleCount, 2.0f);
+        int rows = rowsFor(particleCount, columns);
+        scene.width = columns * s * 4.0f + 2 * WALL_MARGIN;
+        scene.height = rows * s * 1.25f + 2 * WALL_MARGIN;
+        addBlock(scene, rng, WALL_MARGIN, scene.height - WALL_MARGIN, columns, particleCount, { 0.0f, 0.0f });
+        break;
+    }
+    case Scenario::SettledPool: {
+        //      
+        int columns = columnsFor(particleCount, 0.25f);
+        int rows = rowsFor(particleCount, columns);
+        scene.width = (columns - 1) * s + 2 * WALL_MARGIN;
+        scene.height = rows * s * 2.0f + 2 * WALL_MARGIN;
+        addBlock(scene, rng, WALL_MARGIN, scene.height - WALL_MARGIN, columns, particleCount, { 0.0f, 0.0f });
+        break;
+    }
+    case Scenario::DoubleDam: {
+        //        
+        int leftCount = particleCount / 2;
+        int rightCount = particleCount - leftCount;
+        int columns = columnsFor(rightCount, 2.0f);
+        int rows = rowsFor(rightCount, columns);
+        scene.width = columns * s * 6.0f + 2 * WALL_MARGIN;
+        scene.height = rows * s * 1.25f + 2 * WALL_MARGIN;
+        float bottom = scene.height - WALL_MARGIN;
+        addBlock(scene, rng, WALL_MARGIN, bottom, columns, leftCount, { 0.0f, 0.0f });
+        addBlock(scene, rng, scene.width - WALL_MARGIN - (columns - 1) * s, bottom, columns, rightCount, { 0.0f, 0.0f });
+        break;
+    }
+    case Scenario::Jet: {
+        //    :          
+        int jetCount = particleCount / 4;
+        int poolCount = particleCount - jetCount;
+        int poolColumns = columnsFor(poolCount, 0.25f);
+        int poolRows = rowsFor(poolCount, poolColumns);
+        int jetColumns = columnsFor(std::max(jetCount, 1), 1.0f);
+        int jetRows = rowsFor(jetCount, jetColumns);
+        scene.width = (poolColumns - 1) * s + 2 * WALL_MARGIN;
+        scene.height = (poolRows + jetRows) * s * 2.0f + 2 * WALL_MARGIN;
+        float poolBottom = scene.height - WALL_MARGIN;
+        addBlock(scene, rng, WALL_MARGIN, poolBottom, poolColumns, poolCount, { 0.0f, 0.0f });
+        addBlock(scene, rng, WALL_MARGIN, poolBottom - (poolRows + 2) * s, jetColumns, jetCount, { JET_SPEED, 0.0f });
+        break;
+    }
+    }
+    return scene;
+}
+
+const char* scenarioName(Scenario scenario) {
+    switch (scenario) {
+    case Scenario::DamBreak: return "dam_break";
+    case Scenario::SettledPool: return "settled_pool";
+    case Scenario::DoubleDam: return "double_dam";
+    default: return "jet";
+    }
+}
+
+bool parseScenario(const std::string& name, Scenario& scenario) {
+    for (Scenario candidate : { Scenario::DamBreak, Scenario::SettledPool, Scenario::DoubleDam, Scenario::Jet }) {
+        if (name == scenarioName(candidate)) {
+            scenario = candidate;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,22 @@
+#ifndef SCENARIOS_H
+#define SCENARIOS_H
+
+#include <string>
+#include <vector>
+#include "Particle.h"
+
+//     .      
+// PARTICLE_SPACING    ,   
+//   ,      1k  1M 
+enum class Scenario { DamBreak, SettledPool, DoubleDam, Jet };
+
+struct Scene {
+    float width, height;
+    std::vector<Particle> particles;
+};
+
+Scene buildScene(Scenario scenario, int particleCount);
+const char* scenarioName(Scenario scenario);
+bool parseScenario(const std::string& name, Scenario& scenario);
+
+#endif
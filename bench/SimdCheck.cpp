@@ -0,0 +1,77 @@
+#include "SimdCheck.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "Scenarios.h"
+#include "Simulation.h"
+
+constexpr int CHECK_PARTICLES = 3000;
+constexpr int CHECK_STEPS = 30; //   :      
+constexpr float CHECK_RADIUS = 20.0f; //  ,  KERNEL_RADIUS  Simulation
+constexpr float CHECK_CUTOFF = 25.0f; //    h,      
+constexpr float CHECK_VISCOSITY = 0.1f;
+
+bool checkSimdKernels(float tolerance) {
+    Scene scene = buildScene(Scenario::DamBreak, CHECK_PARTICLES);
+    Simulation simulation(scene.width, scene.height);
+    for (const Particle& particle : scene.particles) simulation.addParticle(particle);
+    for (int s = 0; s < CHECK_STEPS; ++s) {
+        simulation.update(1.0f / 60.0f, false, { 0.0f, 0.0f });
+    }
+
+    const ParticleStore& p = simulation.getParticles();
+    SphParticleArrays arrays = { p.x.data(), p.y.data(), p.vx.data(), p.vy.data(), p.density.data(), p.pressure.data() };
+    int count = static_cast<int>(p.size());
+
+    //   , ,   Simulation
+    std::vector<std::vector<int>> neighbors(count);
+    for (int i = 0; i < count; ++i) {
+        for (int j = 0; j < count; ++j) {
+            float dx = p.x[i] - p.x[j];
+            float dy = p.y[i] - p.y[j];
+            if (j != i && dx * dx + dy * dy < CHECK_CUTOFF * CHECK_CUTOFF) neighbors[i].push_back(j);
+        }
+    }
+
+    SphKernelParams params = makeSphKernelParams(CHECK_RADIUS, CHECK_VISCOSITY);
+    SphKernels scalar = selectSphKernels(SimdIsa::Scalar);
+    bool passed = true;
+    for (SimdIsa isa : { SimdIsa::Avx2, SimdIsa::Avx512 }) {
+        SphKernels vector = selectSphKernels(isa);
+        if (vector.isa != isa) {
+            std::printf("%s: not supported, skipped\n", simdIsaName(isa));
+            continue;
+        }
+
+        double densityError = 0.0, forceError = 0.0;
+        std::vector<float> fx, fy, referenceX, referenceY;
+        for (int i = 0; i < count; ++i) {
+            const int* list = neighbors[i].data();
+            int length = static_cast<int>(neighbors[i].size());
+            float reference = scalar.densitySum(arrays, i, list, length, params);
+            float density = vector.densitySum(arrays, i, list, length, params);
+            if (reference > 0.0f) densityError = std::max(densityError, std::fabs(static_cast<double>(density) - reference) / reference);
+
+            fx.assign(length, 0.0f);
+            fy.assign(length, 0.0f);
+            referenceX.assign(length, 0.0f);
+            referenceY.assign(length, 0.0f);
+            scalar.pairForces(arrays, i, list, length, params, referenceX.data(), referenceY.data());
+            vector.pairForces(arrays, i, list, length, params, fx.data(), fy.data());
+            //     ,       
+            double difference = 0.0, scale = 0.0;
+            for (int n = 0; n < length; ++n) {
+                difference += std::hypot(static_cast<double>(fx[n]) - referenceX[n], static_cast<double>(fy[n]) - referenceY[n]);
+                scale += std::hypot(referenceX[n], referenceY[n]);
+            }
+            if (scale > 0.0) forceError = std::max(forceError, difference / scale);
+        }
+
+        bool ok = densityError <= tolerance && forceError <= tolerance;
+        std::printf("%s: max relative error density %.3g, forces %.3g (tolerance %.3g) %s\n",
+            simdIsaName(isa), densityError, forceError, tolerance, ok ? "ok" : "FAILED");
+        passed &= ok;
+    }
+    return passed;
+}
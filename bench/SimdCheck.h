@@ -0,0 +1,11 @@
+#ifndef SIMD_CHECK_H
+#define SIMD_CHECK_H
+
+//            .
+//   - |rho_simd - rho_scalar| / rho_scalar,   -  |f_simd - f_scalar|
+//   ,    |f_scalar|   :       ,
+//      h,    ,    . ,    , .
+// true -      tolerance
+bool checkSimdKernels(float tolerance);
+
+#endif
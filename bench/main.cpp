@@ -0,0 +1,350 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "EmitterCheck.h"
+#include "Profiler.h"
+#include "Scenarios.h"
+#include "SimdCheck.h"
+#include "Simulation.h"
+
+//  :  , N ,    update    
+//     JSON. :
+//   fluidsim_bench --scenario dam_break --particles 1000,100000 --steps 200 --out result.json
+
+constexpr float SIMD_TOLERANCE = 1e-5f; //     ,   SimdKernels.h
+constexpr float EMITTER_MAX_SPEED = 2000.0f; //         
+
+//   :   operator new/delete
+static std::atomic<long long> allocationCount{ 0 };
+
+void* operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size > 0 ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    size_t align = static_cast<size_t>(alignment);
+    size = std::max((size + align - 1) / align * align, align);
+#if defined(_MSC_VER)
+    if (void* memory = _aligned_malloc(size, align)) return memory;
+#else
+    if (void* memory = std::aligned_alloc(align, size)) return memory;
+#endif
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+
+#if defined(_MSC_VER)
+void operator delete(void* memory, std::align_val_t) noexcept { _aligned_free(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { _aligned_free(memory); }
+#else
+void operator delete(void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+#endif
+
+struct BenchOptions {
+    std::vector<Scenario> scenarios = { Scenario::DamBreak, Scenario::SettledPool, Scenario::DoubleDam, Scenario::Jet };
+    std::vector<int> particleCounts = { 1000, 10000, 100000, 1000000 };
+    int steps = 100;
+    int warmup = 20; //   :   ,  
+    int threads = static_cast<int>(std::thread::hardware_concurrency());
+    Grid::Type gridType = Grid::Type::Dense;
+    int reorderInterval = Simulation::REORDER_ADAPTIVE;
+    SimdIsa isa = detectSimdIsa();
+    KernelType kernel = KernelType::Spiky;
+    Simulation::Solver solver = Simulation::Solver::WeaklyCompressible;
+    int iterations = 0; // 0 -  Simulation  
+    float tolerance = 0.0f; // 0 -  Simulation  
+    bool pairCache = false;
+    bool deterministic = false;
+    float frameTime = 1.0f / 60.0f;
+    std::string output; //  -  stdout
+    std::string trace; // Chrome trace  ,    FLUID_PROFILE
+    bool checkSimd = false; //   -     
+    bool checkEmitter = false; //   -  DFSPH   
+};
+
+static const char* kernelName(KernelType kernel) {
+    switch (kernel) {
+    case KernelType::Poly6: return "poly6";
+    case KernelType::WendlandC2: return "wendland_c2";
+    case KernelType::CubicSpline: return "cubic_spline";
+    default: return "spiky";
+    }
+}
+
+static const char* solverName(Simulation::Solver solver) {
+    switch (solver) {
+    case Simulation::Solver::PositionBased: return "pbf";
+    case Simulation::Solver::DivergenceFree: return "dfsph";
+    default: return "wcsph";
+    }
+}
+
+static std::vector<std::string> splitList(const std::string& value) {
+    std::vector<std::string> items;
+    std::stringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+static void printUsage() {
+    std::fprintf(stderr,
+        "usage: fluidsim_bench [options]\n"
+        "  --scenario all|dam_break|settled_pool|double_dam|jet[,...]\n"
+        "  --particles N[,N...]       default 1000,10000,100000,1000000\n"
+        "  --steps N                  measured update() calls, default 100\n"
+        "  --warmup N                 untimed update() calls first, default 20\n"
+        "  --threads N\n"
+        "  --grid dense|sparse\n"
+        "  --reorder adaptive|off|N   Morton reorder mode\n"
+        "  --isa scalar|avx2|avx512\n"
+        "  --kernel spiky|poly6|wendland_c2|cubic_spline\n"
+        "  --solver wcsph|pbf|dfsph\n"
+        "  --iterations N             solver iterations per step (pbf), iteration cap (dfsph)\n"
+        "  --pair-cache on|off        density pass caches pair geometry for the force pass (wcsph)\n"
+        "  --deterministic on|off     results independent of --threads, see checksum\n"
+        "  --tolerance E              average density error to stop at (dfsph), default 0.001\n"
+        "  --frame-time SECONDS       argument of update(), default 1/60\n"
+        "  --out FILE                 JSON output, default stdout\n"
+        "  --check-simd               compare AVX2/AVX-512 density and forces with scalar, exit 1 above 1e-5\n"
+        "  --check-emitter            emit particles under dfsph with every kernel, exit 1 on speeds above 2000 px/s\n"
+        "  --trace FILE               Chrome trace of the measured steps (FLUID_PROFILE builds)\n");
+}
+
+static bool parseOptions(int argc, char** argv, BenchOptions& options) {
+    for (int a = 1; a < argc; ++a) {
+        std::string name = argv[a];
+        if (name == "--check-simd") {
+            options.checkSimd = true;
+            continue;
+        }
+        if (name == "--check-emitter") {
+            options.checkEmitter = true;
+            continue;
+        }
+        if (a + 1 >= argc) return false;
+        std::string value = argv[++a];
+
+        if (name == "--scenario") {
+            options.scenarios.clear();
+            for (const auto& item : splitList(value)) {
+                if (item == "all") {
+                    options.scenarios = BenchOptions().scenarios;
+                    continue;
+                }
+                Scenario scenario;
+                if (!parseScenario(item, scenario)) return false;
+                options.scenarios.push_back(scenario);
+            }
+        }
+        else if (name == "--particles") {
+            options.particleCounts.clear();
+            for (const auto& item : splitList(value)) options.particleCounts.push_back(std::max(std::atoi(item.c_str()), 1));
+        }
+        else if (name == "--steps") options.steps = std::max(std::atoi(value.c_str()), 1);
+        else if (name == "--warmup") options.warmup = std::max(std::atoi(value.c_str()), 0);
+        else if (name == "--threads") options.threads = std::max(std::atoi(value.c_str()), 1);
+        else if (name == "--frame-time") options.frameTime = static_cast<float>(std::atof(value.c_str()));
+        else if (name == "--iterations") options.iterations = std::max(std::atoi(value.c_str()), 1);
+        else if (name == "--tolerance") options.tolerance = std::max(static_cast<float>(std::atof(value.c_str())), 0.0f);
+        else if (name == "--out") options.output = value;
+        else if (name == "--trace") options.trace = value;
+        else if (name == "--pair-cache") {
+            if (value != "on" && value != "off") return false;
+            options.pairCache = value == "on";
+        }
+        else if (name == "--deterministic") {
+            if (value != "on" && value != "off") return false;
+            options.deterministic = value == "on";
+        }
+        else if (name == "--grid") {
+            if (value != "dense" && value != "sparse") return false;
+            options.gridType = value == "sparse" ? Grid::Type::Sparse : Grid::Type::Dense;
+        }
+        else if (name == "--reorder") {
+            if (value == "adaptive") options.reorderInterval = Simulation::REORDER_ADAPTIVE;
+            else if (value == "off") options.reorderInterval = 0;
+            else options.reorderInterval = std::max(std::atoi(value.c_str()), 1);
+        }
+        else if (name == "--isa") {
+            bool found = false;
+            for (SimdIsa isa : { SimdIsa::Scalar, SimdIsa::Avx2, SimdIsa::Avx512 }) {
+                if (value == simdIsaName(isa)) {
+                    options.isa = isa;
+                    found = true;
+                }
+            }
+            if (!found) return false;
+        }
+        else if (name == "--kernel") {
+            bool found = false;
+            for (KernelType kernel : { KernelType::Spiky, KernelType::Poly6, KernelType::WendlandC2, KernelType::CubicSpline }) {
+                if (value == kernelName(kernel)) {
+                    options.kernel = kernel;
+                    found = true;
+                }
+            }
+            if (!found) return false;
+        }
+        else if (name == "--solver") {
+            bool found = false;
+            for (Simulation::Solver solver : { Simulation::Solver::WeaklyCompressible, Simulation::Solver::PositionBased, Simulation::Solver::DivergenceFree }) {
+                if (value == solverName(solver)) {
+                    options.solver = solver;
+                    found = true;
+                }
+            }
+            if (!found) return false;
+        }
+        else return false;
+    }
+    return true;
+}
+
+static std::string reorderName(int interval) {
+    if (interval == Simulation::REORDER_ADAPTIVE) return "adaptive";
+    if (interval == 0) return "off";
+    return std::to_string(interval);
+}
+
+//  : , , .  - JSON-
+static std::string runBenchmark(const BenchOptions& options, Scenario scenario, int particleCount) {
+    Scene scene = buildScene(scenario, particleCount);
+    Simulation simulation(scene.width, scene.height, options.gridType);
+    simulation.setThreadCount(options.threads);
+    simulation.setReorderInterval(options.reorderInterval);
+    simulation.setSimdIsa(options.isa);
+    simulation.setKernel(options.kernel);
+    simulation.setSolver(options.solver);
+    simulation.setPairCache(options.pairCache);
+    simulation.setDeterministic(options.deterministic);
+    if (options.iterations > 0) {
+        simulation.setSolverIterations(options.iterations);
+        simulation.setMaxSolverIterations(options.iterations);
+    }
+    if (options.tolerance > 0.0f) simulation.setDensityErrorTolerance(options.tolerance);
+    for (const Particle& particle : scene.particles) simulation.addParticle(particle);
+
+    for (int s = 0; s < options.warmup; ++s) {
+        simulation.update(options.frameTime, false, { 0.0f, 0.0f });
+    }
+
+    simulation.resetStageTimings();
+    simulation.resetNeighborStats();
+    simulation.resetWorkerStats();
+    simulation.resetSolverStats();
+    Profiler::clear(); //        
+    long long allocationsBefore = allocationCount.load();
+    auto start = std::chrono::steady_clock::now();
+    for (int s = 0; s < options.steps; ++s) {
+        simulation.update(options.frameTime, false, { 0.0f, 0.0f });
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    long long allocations = allocationCount.load() - allocationsBefore;
+
+    const Simulation::StageTimings& timings = simulation.getStageTimings();
+    double particleSteps = static_cast<double>(particleCount) * std::max(timings.steps, 1);
+    auto nsPerParticleStep = [&](double seconds) { return seconds * 1e9 / particleSteps; };
+
+    //  :     
+    double busyMax = 0.0, busySum = 0.0;
+    long long tasks = 0, steals = 0;
+    std::vector<ThreadPool::WorkerStats> workers = simulation.getWorkerStats();
+    for (const auto& worker : workers) {
+        busyMax = std::max(busyMax, worker.busySeconds);
+        busySum += worker.busySeconds;
+        tasks += worker.tasks;
+        steals += worker.steals;
+    }
+    double imbalance = busySum > 0.0 ? busyMax * workers.size() / busySum : 1.0;
+
+    const Simulation::NeighborStats& neighbors = simulation.getNeighborStats();
+    const Simulation::SolverStats& solverStats = simulation.getSolverStats();
+    double solverSteps = static_cast<double>(std::max(solverStats.steps, 1));
+    char buffer[2048];
+    std::snprintf(buffer, sizeof(buffer),
+        "  {\"scenario\": \"%s\", \"particles\": %d, \"steps\": %d, \"substeps\": %d, \"threads\": %d, "
+        "\"grid\": \"%s\", \"reorder\": \"%s\", \"isa\": \"%s\", \"kernel\": \"%s\", \"solver\": \"%s\", \"iterations\": %d, \"pairCache\": \"%s\",\n"
+        "   \"nsPerParticleStep\": {\"neighbors\": %.3f, \"density\": %.3f, \"pressure\": %.3f, \"forces\": %.3f, \"solver\": %.3f, \"advance\": %.3f, \"update\": %.3f},\n"
+        "   \"allocationsPerStep\": %.3f, \"pairCacheBytes\": %zu,\n"
+        "   \"deterministic\": \"%s\", \"checksum\": \"%016llx\",\n"
+        "   \"solverIterations\": {\"density\": %.2f, \"divergence\": %.2f, \"lastDensityError\": %.6f, \"lastMaxDensityError\": %.6f},\n"
+        "   \"neighborLists\": {\"averageLength\": %.2f, \"rebuilds\": %d},\n"
+        "   \"workers\": {\"imbalance\": %.3f, \"tasks\": %lld, \"steals\": %lld}}",
+        scenarioName(scenario), particleCount, options.steps, timings.steps, simulation.getThreadCount(),
+        options.gridType == Grid::Type::Sparse ? "sparse" : "dense", reorderName(options.reorderInterval).c_str(),
+        simdIsaName(simulation.getSimdIsa()), kernelName(options.kernel), solverName(options.solver),
+        options.solver == Simulation::Solver::DivergenceFree ? simulation.getMaxSolverIterations() : simulation.getSolverIterations(),
+        options.pairCache ? "on" : "off",
+        nsPerParticleStep(timings.neighbors), nsPerParticleStep(timings.density), nsPerParticleStep(timings.pressure),
+        nsPerParticleStep(timings.forces), nsPerParticleStep(timings.solver), nsPerParticleStep(timings.advance), nsPerParticleStep(elapsed),
+        static_cast<double>(allocations) / options.steps, simulation.getPairCacheBytes(),
+        options.deterministic ? "on" : "off", static_cast<unsigned long long>(simulation.getStateChecksum()),
+        solverStats.densityIterations / solverSteps, solverStats.divergenceIterations / solverSteps, solverStats.lastDensityError, solverStats.lastMaxDensityError,
+        neighbors.averageListLength, neighbors.rebuilds,
+        imbalance, tasks, steals);
+    return buffer;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+    if (options.checkSimd) {
+        return checkSimdKernels(SIMD_TOLERANCE) ? 0 : 1;
+    }
+    if (options.checkEmitter) {
+        return checkEmitterStability(EMITTER_MAX_SPEED) ? 0 : 1;
+    }
+
+    FILE* output = stdout;
+    if (!options.output.empty()) {
+        output = std::fopen(options.output.c_str(), "w");
+        if (output == nullptr) {
+            std::fprintf(stderr, "cannot open %s\n", options.output.c_str());
+            return 1;
+        }
+    }
+
+    std::fprintf(output, "[\n");
+    bool first = true;
+    for (Scenario scenario : options.scenarios) {
+        for (int particleCount : options.particleCounts) {
+            std::fprintf(stderr, "%s, %d particles...\n", scenarioName(scenario), particleCount);
+            std::string result = runBenchmark(options, scenario, particleCount);
+            std::fprintf(output, "%s%s", first ? "" : ",\n", result.c_str());
+            std::fflush(output);
+            first = false;
+        }
+    }
+    std::fprintf(output, "\n]\n");
+    if (output != stdout) std::fclose(output);
+
+    if (!options.trace.empty()) {
+        if (!Profiler::isEnabled()) {
+            std::fprintf(stderr, "profiler is compiled out, rebuild with FLUID_PROFILE to get a trace\n");
+        }
+        else if (!Profiler::writeChromeTrace(options.trace)) {
+            std::fprintf(stderr, "cannot write %s\n", options.trace.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef COLOR_H
+#define COLOR_H
+
+#include <cstdint>
+
+//   RGBA.         
+struct Color {
+    uint8_t r = 0;
+    uint8_t g = 0;
+    uint8_t b = 0;
+    uint8_t a = 255;
+
+    static const Color Blue;
+};
+
+inline constexpr Color Color::Blue{ 0, 0, 255, 255 };
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "ParticleStore.h"
+#include "Vec2.h"
+
+//    .    ,   
+// (counting sort):    c   particleIndices[cellStart[c], cellEnd[c]).
+//  Dense  -      ,   - y * numCellsX + x
+//  Sparse - -       .   
+//                ,     .
+//             -  int,       .
+//            Simulation     [0, width] x [0, height]:   -
+//             ,        
+struct Grid {
+    enum class Type { Dense, Sparse };
+
+    Type type;
+    float cellSize;
+    int numCellsX, numCellsY; //   Dense
+    std::vector<int> cellStart; //     particleIndices
+    std::vector<int> cellEnd; //    ( )
+    std::vector<uint64_t> particleKeys; //     (particleKey) -  buildFromKeys
+    std::vector<int> particleCells; //   
+    std::vector<int> particleIndices; //  ,   
+    std::vector<int> mortonOrder; //      (Z-order)
+
+    // Sparse:     - "  ->  "
+    std::vector<Vec2i> cellCoords;
+    std::vector<uint64_t> tableKeys;
+    std::vector<int> tableCells;
+    uint64_t tableMask = 0;
+
+    Grid(Type type, float width, float height, float size);
+    int getCellIndex(Vec2 pos) const; //   Dense
+    void build(const ParticleStore& particles); //  particleKeys     buildFromKeys
+    void buildFromKeys(); //        particleKeys
+    uint64_t mortonCode(int cellIndex) const; // 64-:  32   
+    void sortCellsByMorton(); //  Sparse       
+
+    Vec2i cellCoord(Vec2 pos) const {
+        return { static_cast<int>(std::floor(pos.x / cellSize)), static_cast<int>(std::floor(pos.y / cellSize)) };
+    }
+
+    static uint64_t cellKey(int x, int y) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+    }
+
+    //   :  Dense -  ,  Sparse - cellKey 
+    uint64_t particleKey(Vec2 pos) const {
+        if (type == Type::Dense) return static_cast<uint64_t>(getCellIndex(pos));
+        Vec2i coord = cellCoord(pos);
+        return cellKey(coord.x, coord.y);
+    }
+
+    //     -1,      (  Sparse)
+    int findCell(int x, int y) const {
+        uint64_t key = cellKey(x, y);
+        for (uint64_t slot = hashSlot(key);; slot = (slot + 1) & tableMask) {
+            if (tableCells[slot] < 0) return -1;
+            if (tableKeys[slot] == key) return tableCells[slot];
+        }
+    }
+
+    //       3x3    
+    template <typename Fn>
+    void forEachNeighbor(Vec2 pos, Fn&& fn) const {
+        if (type == Type::Dense) {
+            //      particleIndices ,   -  
+            int x = static_cast<int>(pos.x / cellSize);
+            int y = static_cast<int>(pos.y / cellSize);
+            int minX = std::max(x - 1, 0);
+            int maxX = std::min(x + 1, numCellsX - 1);
+            int minY = std::max(y - 1, 0);
+            int maxY = std::min(y + 1, numCellsY - 1);
+
+            for (int cellY = minY; cellY <= maxY; ++cellY) {
+                int rowBegin = cellStart[cellY * numCellsX + minX];
+                int rowEnd = cellEnd[cellY * numCellsX + maxX];
+                for (int k = rowBegin; k < rowEnd; ++k) {
+                    fn(particleIndices[k]);
+                }
+            }
+            return;
+        }
+
+        if (cellCoords.empty()) return;
+        Vec2i center = cellCoord(pos);
+        for (int cellY = center.y - 1; cellY <= center.y + 1; ++cellY) {
+            for (int cellX = center.x - 1; cellX <= center.x + 1; ++cellX) {
+                int cellIndex = findCell(cellX, cellY);
+                if (cellIndex < 0) continue;
+                for (int k = cellStart[cellIndex]; k < cellEnd[cellIndex]; ++k) {
+                    fn(particleIndices[k]);
+                }
+            }
+        }
+    }
+
+private:
+    uint64_t hashSlot(uint64_t key) const {
+        return (key * 0x9E3779B97F4A7C15ull >> 32) & tableMask;
+    }
+
+    int insertCell(uint64_t key);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,159 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cmath>
+#include <numbers>
+
+//   SPH     H,   .
+//  - constexpr   ,     r2,
+//      (Poly6) sqrt   .
+// value(r2) -  W, gradientFactor(r2) -  g,   grad W(r) = r * g.
+//     , gradientFactor      .
+// valueAt(r)  derivativeAt(r) -   W  dW/dr    r < H   ,
+//    : grad W(r) = derivativeAt(|r|) * r / |r|
+enum class KernelType { Spiky, Poly6, WendlandC2, CubicSpline };
+
+// Spiky    ,    kernel()/kernelGradient():   
+// PRESSURE_CONSTANT  REST_DENSITY.    SimdKernels.h    
+template <float H>
+struct SpikyKernel {
+    static constexpr float radius = H;
+    static constexpr float densityNorm = static_cast<float>(6.0 / (std::numbers::pi * H * H * H * H * H));
+    static constexpr float gradientNorm = static_cast<float>(-3.0 / (std::numbers::pi * H * H * H * H * H));
+
+    static float value(float r2) {
+        float t = H - std::sqrt(r2);
+        return r2 < H * H ? densityNorm * t * t * t : 0.0f;
+    }
+
+    static float gradientFactor(float r2) {
+        float r = std::sqrt(r2);
+        float t = H - r;
+        return r2 < H * H && r2 > 0.0f ? gradientNorm * t * t / r : 0.0f;
+    }
+
+    static float valueAt(float r) {
+        float t = H - r;
+        return densityNorm * t * t * t;
+    }
+
+    static float derivativeAt(float r) {
+        float t = H - r;
+        return gradientNorm * t * t;
+    }
+};
+
+//   Spiky      value.     ,
+//       (PBF)    
+template <float H>
+struct SpikyExactGradientKernel : SpikyKernel<H> {
+    static constexpr float gradientNorm = -3.0f * SpikyKernel<H>::densityNorm;
+
+    static float gradientFactor(float r2) {
+        float r = std::sqrt(r2);
+        float t = H - r;
+        return r2 < H * H && r2 > 0.0f ? gradientNorm * t * t / r : 0.0f;
+    }
+
+    static float derivativeAt(float r) {
+        float t = H - r;
+        return gradientNorm * t * t;
+    }
+};
+
+// Poly6: W = 4 / (pi H^8) * (H^2 - r^2)^3,   
+template <float H>
+struct Poly6Kernel {
+    static constexpr float radius = H;
+    static constexpr float densityNorm = static_cast<float>(4.0 / (std::numbers::pi * H * H * H * H * H * H * H * H));
+    static constexpr float gradientNorm = -6.0f * densityNorm;
+
+    static constexpr float value(float r2) {
+        float t = H * H - r2;
+        return r2 < H * H ? densityNorm * t * t * t : 0.0f;
+    }
+
+    static constexpr float gradientFactor(float r2) {
+        float t = H * H - r2;
+        return r2 < H * H ? gradientNorm * t * t : 0.0f;
+    }
+
+    static constexpr float valueAt(float r) {
+        return value(r * r);
+    }
+
+    static constexpr float derivativeAt(float r) {
+        return gradientFactor(r * r) * r;
+    }
+};
+
+// Wendland C2 (2D): W = 7 / (pi H^2) * (1 - q)^4 * (1 + 4q), q = r / H
+template <float H>
+struct WendlandC2Kernel {
+    static constexpr float radius = H;
+    static constexpr float densityNorm = static_cast<float>(7.0 / (std::numbers::pi * H * H));
+    static constexpr float gradientNorm = -20.0f * densityNorm / (H * H);
+
+    static float value(float r2) {
+        float q = std::sqrt(r2) * (1.0f / H);
+        float t = 1.0f - q;
+        float t2 = t * t;
+        return r2 < H * H ? densityNorm * t2 * t2 * (1.0f + 4.0f * q) : 0.0f;
+    }
+
+    static float gradientFactor(float r2) {
+        float t = 1.0f - std::sqrt(r2) * (1.0f / H);
+        return r2 < H * H ? gradientNorm * t * t * t : 0.0f;
+    }
+
+    static float valueAt(float r) {
+        float q = r * (1.0f / H);
+        float t = 1.0f - q;
+        float t2 = t * t;
+        return densityNorm * t2 * t2 * (1.0f + 4.0f * q);
+    }
+
+    static float derivativeAt(float r) {
+        float t = 1.0f - r * (1.0f / H);
+        return gradientNorm * t * t * t * r;
+    }
+};
+
+//   (2D)   H: W = s * (6q^3 - 6q^2 + 1)  q <= 1/2
+//  2s * (1 - q)^3 , s = 40 / (7 pi H^2)
+template <float H>
+struct CubicSplineKernel {
+    static constexpr float radius = H;
+    static constexpr float densityNorm = static_cast<float>(40.0 / (7.0 * std::numbers::pi * H * H));
+    static constexpr float gradientNorm = densityNorm / (H * H);
+
+    static float value(float r2) {
+        float q = std::sqrt(r2) * (1.0f / H);
+        float t = 1.0f - q;
+        float inner = densityNorm * (6.0f * q * q * (q - 1.0f) + 1.0f);
+        float outer = 2.0f * densityNorm * t * t * t;
+        return r2 < H * H ? (q <= 0.5f ? inner : outer) : 0.0f;
+    }
+
+    static float gradientFactor(float r2) {
+        float q = std::sqrt(r2) * (1.0f / H);
+        float t = 1.0f - q;
+        float inner = gradientNorm * (18.0f * q - 12.0f);
+        float outer = -6.0f * gradientNorm * t * t / q;
+        return r2 < H * H && r2 > 0.0f ? (q <= 0.5f ? inner : outer) : 0.0f;
+    }
+
+    static float valueAt(float r) {
+        float q = r * (1.0f / H);
+        float t = 1.0f - q;
+        return q <= 0.5f ? densityNorm * (6.0f * q * q * (q - 1.0f) + 1.0f) : 2.0f * densityNorm * t * t * t;
+    }
+
+    static float derivativeAt(float r) {
+        float q = r * (1.0f / H);
+        float t = 1.0f - q;
+        return q <= 0.5f ? gradientNorm * (18.0f * q - 12.0f) * r : -6.0f * gradientNorm * t * t * H;
+    }
+};
+
+#endif
@@ -1,14 +1,15 @@
 #ifndef PARTICLE_H
 #define PARTICLE_H
 
-#include <SFML/Graphics.hpp>
+#include "Color.h"
+#include "Vec2.h"
 
 struct Particle {
-    sf::Vector2f position;
-    sf::Vector2f velocity;
-    sf::Color color;
-    float density;
-    float pressure;
+    Vec2 position;
+    Vec2 velocity;
+    Color color;
+    float density = 0.0f;
+    float pressure = 0.0f;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,28 @@
+#ifndef PARTICLE_SNAPSHOT_H
+#define PARTICLE_SNAPSHOT_H
+
+#include <vector>
+#include "Color.h"
+#include "ParticleStore.h"
+
+//   ,   ,     .
+//  :       
+struct ParticleSnapshot {
+    std::vector<float> x, y;
+    std::vector<float> previousX, previousY;
+    std::vector<Color> color;
+    double time = 0.0; //  ,  steady_clock
+
+    size_t size() const { return x.size(); }
+
+    void assign(const ParticleStore& particles, double publishTime) {
+        x = particles.x;
+        y = particles.y;
+        previousX = particles.previousX;
+        previousY = particles.previousY;
+        color = particles.color;
+        time = publishTime;
+    }
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef PARTICLE_STORE_H
+#define PARTICLE_STORE_H
+
+#include <vector>
+#include "Particle.h"
+
+//      (SoA):       .
+//   -    float,   () - .
+// Renderer         ,  
+struct ParticleStore {
+    std::vector<float> x, y; // 
+    std::vector<float> previousX, previousY; //     Simulation::update,  
+    std::vector<float> vx, vy; // 
+    std::vector<float> density;
+    std::vector<float> pressure; //   DFSPH - kappa = p / rho^2  
+    std::vector<float> divergencePressure; // DFSPH: kappa  
+    std::vector<Color> color;
+
+    size_t size() const { return x.size(); }
+    bool empty() const { return x.empty(); }
+
+    Vec2 position(size_t i) const { return { x[i], y[i] }; }
+    Vec2 velocity(size_t i) const { return { vx[i], vy[i] }; }
+
+    void add(const Particle& p) {
+        x.push_back(p.position.x);
+        y.push_back(p.position.y);
+        previousX.push_back(p.position.x);
+        previousY.push_back(p.position.y);
+        vx.push_back(p.velocity.x);
+        vy.push_back(p.velocity.y);
+        density.push_back(p.density);
+        pressure.push_back(p.pressure);
+        divergencePressure.push_back(0.0f);
+        color.push_back(p.color);
+    }
+
+    //     -     ,   
+    void resize(size_t count) {
+        x.resize(count);
+        y.resize(count);
+        previousX.resize(count);
+        previousY.resize(count);
+        vx.resize(count);
+        vy.resize(count);
+        density.resize(count);
+        pressure.resize(count);
+        divergencePressure.resize(count);
+        color.resize(count);
+    }
+
+    Particle get(size_t i) const {
+        return { position(i), velocity(i), color[i], density[i], pressure[i] };
+    }
+
+    // :   k -   order[k].    scratch,
+    //     ,      
+    void permute(const std::vector<int>& order, ParticleStore& scratch) {
+        permuteArray(x, scratch.x, order);
+        permuteArray(y, scratch.y, order);
+        permuteArray(previousX, scratch.previousX, order);
+        permuteArray(previousY, scratch.previousY, order);
+        permuteArray(vx, scratch.vx, order);
+        permuteArray(vy, scratch.vy, order);
+        permuteArray(density, scratch.density, order);
+        permuteArray(pressure, scratch.pressure, order);
+        permuteArray(divergencePressure, scratch.divergencePressure, order);
+        permuteArray(color, scratch.color, order);
+    }
+
+private:
+    template <typename T>
+    static void permuteArray(std::vector<T>& values, std::vector<T>& scratch, const std::vector<int>& order) {
+        scratch.resize(order.size());
+        for (size_t k = 0; k < order.size(); ++k) {
+            scratch[k] = values[order[k]];
+        }
+        values.swap(scratch);
+    }
+};
+
+#endif
\ No newline at end of file
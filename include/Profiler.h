@@ -0,0 +1,65 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <string>
+
+//  : FLUID_PROFILE_ZONE(name)     ,
+// FLUID_PROFILE_COUNTER(name, value)        .
+//          ,   .
+//   FLUID_PROFILE    ,     
+class Profiler {
+public:
+    static constexpr int MAX_COUNTERS = 2; //    
+    static constexpr int RING_CAPACITY = 1 << 16; //     
+
+    struct Event {
+        const char* name; //  
+        int64_t begin, end; //      
+        const char* counterNames[MAX_COUNTERS];
+        long long counterValues[MAX_COUNTERS];
+        int counterCount;
+    };
+
+    static bool isEnabled(); //     FLUID_PROFILE
+    static int64_t now();
+    static void record(const Event& event);
+
+    // Chrome trace_event JSON (  Perfetto  chrome://tracing).
+    // ,      -    
+    static bool writeChromeTrace(const std::string& path);
+    static void clear();
+};
+
+#ifdef FLUID_PROFILE
+
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name);
+    ~ProfileZone();
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+    void counter(const char* name, long long value);
+    static ProfileZone* current(); //       nullptr
+
+private:
+    Profiler::Event event;
+    ProfileZone* parent;
+};
+
+#define FLUID_PROFILE_CONCAT_INNER(a, b) a##b
+#define FLUID_PROFILE_CONCAT(a, b) FLUID_PROFILE_CONCAT_INNER(a, b)
+#define FLUID_PROFILE_ZONE(name) ProfileZone FLUID_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define FLUID_PROFILE_COUNTER(name, value) \
+    do { if (ProfileZone* zone = ProfileZone::current()) zone->counter(name, static_cast<long long>(value)); } while (false)
+
+#else
+
+#define FLUID_PROFILE_ZONE(name) ((void)0)
+#define FLUID_PROFILE_COUNTER(name, value) ((void)0)
+
+#endif
+
+#endif
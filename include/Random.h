@@ -0,0 +1,68 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstdint>
+
+//  xoshiro128** (Blackman, Vigna): 128  , 32-   
+//   .    rand()   ,  
+//          .
+//   (stream) -      : 
+//  splitmix64   (seed, stream).    -   ,
+//           
+class Xoshiro128 {
+public:
+    explicit Xoshiro128(uint64_t seed = 0, uint64_t stream = 0) {
+        uint64_t streamKey = stream;
+        uint64_t mixer = seed ^ splitMix64(streamKey);
+        uint64_t low = splitMix64(mixer);
+        uint64_t high = splitMix64(mixer);
+        state[0] = static_cast<uint32_t>(low);
+        state[1] = static_cast<uint32_t>(low >> 32);
+        state[2] = static_cast<uint32_t>(high);
+        state[3] = static_cast<uint32_t>(high >> 32);
+    }
+
+    uint32_t next() {
+        uint32_t result = rotateLeft(state[1] * 5, 7) * 9;
+        uint32_t t = state[1] << 9;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotateLeft(state[3], 11);
+        return result;
+    }
+
+    //   [0, 1):  24  -   float
+    float nextFloat() {
+        return static_cast<float>(next() >> 8) * (1.0f / 16777216.0f);
+    }
+
+    float uniform(float min, float max) {
+        return min + (max - min) * nextFloat();
+    }
+
+    //   [min, max]       
+    int uniformInt(int min, int max) {
+        uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(max) - min) + 1;
+        return static_cast<int>(min + static_cast<int64_t>((next() * range) >> 32));
+    }
+
+private:
+    static uint32_t rotateLeft(uint32_t value, int shift) {
+        return (value << shift) | (value >> (32 - shift));
+    }
+
+    // splitmix64:  x     
+    static uint64_t splitMix64(uint64_t& x) {
+        uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    uint32_t state[4];
+};
+
+#endif
@@ -2,16 +2,21 @@
 #define RENDERER_H
 
 #include <SFML/Graphics.hpp>
-#include <vector>
-#include "Particle.h"
+#include "ParticleSnapshot.h"
 
+//   SFML:      ,   
 class Renderer {
 public:
     Renderer(sf::RenderWindow& window);
-    void render(const std::vector<Particle>& particles); //  
+    //  . alpha -    previousX/previousY   :
+    //   ,     ,   
+    void render(const ParticleSnapshot& particles, float alpha = 1.0f);
 
 private:
     sf::RenderWindow& window;
+    //   -        ,   .
+    //           
+    sf::VertexArray vertices;
 };
 
 #endif
\ No newline at end of file
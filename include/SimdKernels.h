@@ -0,0 +1,49 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+//   SPH (      )   :
+//  , AVX2 (8   )  AVX-512 (16   ).
+//        CPUID,     /arch.
+//  - Spiky (SpikyKernel  Kernels.h),      Simulation.
+//         FMA: 
+//       1e-5.  -     h,
+//  (h - r)     r   ulp 
+enum class SimdIsa { Scalar, Avx2, Avx512 };
+
+//   Spiky  
+struct SphKernelParams {
+    float h; //  
+    float densityNorm; //  : W(r) = densityNorm * (h - r)^3
+    float gradientNorm; //  : |grad W(r)| = gradientNorm * (h - r)^2
+    float viscosity;
+};
+
+//    ParticleStore
+struct SphParticleArrays {
+    const float* x;
+    const float* y;
+    const float* vx;
+    const float* vy;
+    const float* density;
+    const float* pressure; //       
+};
+
+//  W(|r_ij|)   neighbors[0, count)  i (   )
+using DensitySumFunction = float (*)(const SphParticleArrays& particles, int i, const int* neighbors, int count, const SphKernelParams& params);
+
+//    ,   i    : fx[n], fy[n]  neighbors[n].
+//   -   p_i + p_j.   h   
+using PairForcesFunction = void (*)(const SphParticleArrays& particles, int i, const int* neighbors, int count, const SphKernelParams& params, float* fx, float* fy);
+
+struct SphKernels {
+    SimdIsa isa;
+    DensitySumFunction densitySum;
+    PairForcesFunction pairForces;
+};
+
+SimdIsa detectSimdIsa(); //   ,    
+const char* simdIsaName(SimdIsa isa);
+SphKernelParams makeSphKernelParams(float h, float viscosity);
+SphKernels selectSphKernels(SimdIsa isa); //     
+
+#endif
\ No newline at end of file
@@ -1,43 +1,307 @@
 #ifndef SIMULATION_H
 #define SIMULATION_H
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <vector>
-#include <SFML/Graphics.hpp>
+#include "Grid.h"
+#include "Kernels.h"
 #include "Particle.h"
+#include "ParticleStore.h"
+#include "Random.h"
+#include "SimdKernels.h"
+#include "ThreadPool.h"
+#include "Vec2.h"
+
+//    (PBF  DFSPH)         
+struct IncompressibleKernels {
+    float restDensity; //      REST_SPACING
+    float restGradientSq; // sum |grad W_ij|^2   
+    float relaxation; //  lambda     (CFM)
+
+    // lambda_i = -C_i / (sum |grad C_i|^2 + relaxation), C_i = max(rho_i / rho_0 - 1, 0).  
+    float (*constraintLambda)(const SphParticleArrays& p, int i, const int* neighbors, int count, float restDensity, float relaxation, float& density);
+    // dp_i = 1 / rho_0 * sum (lambda_i + lambda_j) grad W_ij
+    void (*positionCorrection)(const SphParticleArrays& p, const float* lambda, int i, const int* neighbors, int count, float restDensity, float& dx, float& dy);
+    //  XSPH: dv_i = c * sum (v_j - v_i) W_ij / rho_j
+    void (*xsphVelocity)(const SphParticleArrays& p, int i, const int* neighbors, int count, float viscosity, float& dvx, float& dvy);
+
+    // DFSPH: alpha_i = 1 / (|sum grad W_ij|^2 + sum |grad W_ij|^2)  0     .  
+    float (*divergenceFactor)(const SphParticleArrays& p, int i, const int* neighbors, int count, float minDenominator, float& density);
+    //    D rho_i / Dt = sum (v_i - v_j) . grad W_ij
+    float (*densityChangeRate)(const SphParticleArrays& p, int i, const int* neighbors, int count);
+    //   a_i = -sum (kappa_i + kappa_j) grad W_ij, kappa = p / rho^2
+    void (*pressureAcceleration)(const SphParticleArrays& p, const float* kappa, int i, const int* neighbors, int count, float& ax, float& ay);
+};
+
+//    :   h,        
+struct PairEntry {
+    int neighbor;
+    float distance;
+    float directionX, directionY;
+};
+
+//  WCSPH       
+struct PairCacheKernels {
+    //  W  ,  densitySum.   h   pairs      pairCount
+    float (*densityEmit)(const SphParticleArrays& p, int i, const int* neighbors, int count, PairEntry* pairs, int& pairCount);
+    //  ,  pairForces,       
+    void (*pairForces)(const SphParticleArrays& p, int i, const PairEntry* pairs, int count, const SphKernelParams& params, float* fx, float* fy);
+};
 
 class Simulation {
 public:
-    Simulation();
-    void update(float dt, bool isLeftMousePressed, sf::Vector2f mousePosition); //    
-    const std::vector<Particle>& getParticles() const;
-    void spawnParticles(sf::Vector2f position, sf::Color color); // ,    
+    //    .       
+    //   Grid::Type::Sparse -     
+    Simulation(float width = 1024.0f, float height = 768.0f, Grid::Type gridType = Grid::Type::Dense);
+    void update(float frameTime, bool isLeftMousePressed, Vec2 mousePosition); //    
+    const ParticleStore& getParticles() const;
+    void spawnParticles(Vec2 position, Color color); // ,    
+    void addParticle(const Particle& particle); //     ,   
+    // count    radius  center   .  
+    // ,       -      
+    void emitParticles(Vec2 center, float radius, Vec2 velocity, Color color, int count);
 
-private:
-    std::vector<Particle> particles;
+    //           :
+    // steps > 0 -  steps , 0 - , REORDER_ADAPTIVE -    
+    static constexpr int REORDER_ADAPTIVE = -1;
+    void setReorderInterval(int steps);
 
-    // Uniform Grid
-    struct Grid {
-        int width, height;
-        float cellSize;
-        std::vector<std::vector<int>> cells;
-
-        Grid(int w, int h, float size);
-        int getCellIndex(sf::Vector2f pos) const;
-        void addParticle(int particleIndex, sf::Vector2f pos);
-        void clear();
-        std::vector<int> getNeighbors(sf::Vector2f pos) const;
+    //   :   KERNEL_RADIUS + skin,   
+    // -      skin / 2    
+    struct NeighborStats {
+        int steps = 0; //     
+        int rebuilds = 0; //    
+        float averageListLength = 0.0f; //      
     };
+    void setNeighborSkin(float skin);
+    const NeighborStats& getNeighborStats() const;
+    void resetNeighborStats();
 
+    //      :     ,
+    //     (  )   
+    void setSymmetricForces(bool enabled);
+
+    //   (WCSPH):      h     ,
+    //          .  16   
+    //  ,        Spiky
+    void setPairCache(bool enabled);
+    size_t getPairCacheBytes() const; //   
+
+    //  :        .
+    //       ,       
+    // ,            , 
+    //    .  -       
+    void setDeterministic(bool enabled);
+    bool isDeterministic() const;
+    void setSeed(uint64_t seed); //   ,     
+    uint64_t getStateChecksum() const; //         
+
+    //      (  )
+    void setThreadCount(int threads);
+    int getThreadCount() const;
+
+    //  :  ,    .   
+    std::vector<ThreadPool::WorkerStats> getWorkerStats() const;
+    void resetWorkerStats();
+
+    //       .   -   ,
+    //      
+    void setSimdIsa(SimdIsa isa);
+    SimdIsa getSimdIsa() const;
+
+    //  . Spiky   ,  -  
+    //     .     Spiky
+    void setKernel(KernelType type);
+    KernelType getKernel() const;
+
+    //  :          .
+    // Linear: p = k (rho - rho_0), Tait: p = k rho_0 / gamma * ((rho / rho_0)^gamma - 1).
+    //    k    rho_0
+    enum class EquationOfState { Linear, Tait };
+    void setEquationOfState(EquationOfState eos);
+    EquationOfState getEquationOfState() const;
+    void setStiffness(float stiffness);
+    float getStiffness() const;
+
+    // . WeaklyCompressible -         
+    // . PositionBased (PBF) -      
+    //     ,  1/60    .   -  .
+    // DivergenceFree (DFSPH) -  :    , 
+    //    ,      . 
+    //   -    .    CFL  
+    enum class Solver { WeaklyCompressible, PositionBased, DivergenceFree };
+    void setSolver(Solver solver);
+    Solver getSolver() const;
+    void setSolverIterations(int iterations); // PBF:   
+    int getSolverIterations() const;
+    void setMaxSolverIterations(int iterations); // DFSPH:      
+    int getMaxSolverIterations() const;
+    void setDensityErrorTolerance(float tolerance); // DFSPH:   |rho / rho_0 - 1|,    -  
+    float getDensityErrorTolerance() const;
+
+    //      
+    struct SolverStats {
+        int steps = 0;
+        long long densityIterations = 0; // PBF -  , DFSPH -  
+        long long divergenceIterations = 0; //  DFSPH
+        int lastDensityIterations = 0;
+        int lastDivergenceIterations = 0;
+        float lastDensityError = 0.0f; // DFSPH:       
+        float lastMaxDensityError = 0.0f; // DFSPH:       
+    };
+    const SolverStats& getSolverStats() const;
+    void resetSolverStats();
+
+    //  : update  frameTime     
+    // safety * min(h / v_max, sqrt(h / a_max), h^2 / mu). v_max  a_max    .
+    //    maxSubsteps   ,     
+    void setSafetyFactor(float factor);
+    void setMaxSubsteps(int substeps);
+    float getLastTimeStep() const; // dt  
+    int getLastSubsteps() const; //     update
+
+    //         
+    struct StageTimings {
+        int steps = 0; // ,    update
+        double neighbors = 0.0; // ,    
+        double density = 0.0;
+        double pressure = 0.0;
+        double forces = 0.0;
+        double advance = 0.0; // , ,    
+        double solver = 0.0; //    PBF  DFSPH
+    };
+    const StageTimings& getStageTimings() const;
+    void resetStageTimings();
+
+private:
+    ParticleStore particles;
+
+    // Uniform Grid
+    float width, height;
     Grid grid;
+    void step(float dt);
+    void stepPositionBased(float dt);
+    void stepDivergenceFree(float dt);
+    float stableTimeStep() const;
+    void updateNeighbors();
+    bool needsNeighborRebuild() const;
+    void buildNeighborLists();
+    void buildCellTasks();
     void updateGrid();
+    bool needsReorder() const;
+    void reorderParticles();
     void updateDensity();
-    void updateForces(float dt);
-    void integrate(float dt);
-    void handleBoundaryCollisions();
+    void updateDensityWithPairCache();
+    void updatePressure();
+    void updateForces();
+    void updateForcesSymmetric();
+    void accumulatePairForces(int begin, int end, std::vector<Vec2>& forces, std::vector<float>& scratch) const;
+    void advanceParticles(float dt);
+    void handleBoundaryCollision(float& x, float& y, float& vx, float& vy) const;
+    void predictPositions(float dt);
+    void solveDensityConstraints();
+    void updatePositionBasedVelocities(float dt);
+    void applyXsphViscosity();
+    void computeDivergenceFactors();
+    int solvePressure(std::vector<float>& kappa, bool densityError, float dt, float& averageError, float& maxError);
+    void applyNonPressureForces(float dt);
+    void advancePositions(float dt);
+    void constrainWallVelocity(int i);
+    SphParticleArrays particleArrays() const;
+    void selectKernels();
 
     //    
     const float SPAWN_RADIUS = 10.0f; //     
     const int MAX_PARTICLES_PER_FRAME = 5; //     
+    //      .   -   
+    //   32      
+    uint64_t spawnSeed;
+    uint64_t spawnCalls = 0;
+
+    //  
+    int reorderInterval = REORDER_ADAPTIVE;
+    int stepsSinceReorder = 0;
+    std::vector<int> reorderOrder; //    (  )
+    ParticleStore reorderBuffer; //    
+
+    //     CSR:   i - neighborList[neighborStart[i], neighborStart[i + 1]).
+    //   ,     i   neighborUpper[i]
+    float neighborSkin;
+    std::vector<int> neighborStart;
+    std::vector<int> neighborUpper;
+    std::vector<int> neighborList;
+    int maxListLength = 0;
+    std::vector<Vec2> lastBuildPositions; //      
+    std::atomic<bool> neighborsMoved = false; //  advanceParticles    skin / 2
+    NeighborStats neighborStats;
+
+    //  .         ,  
+    // ,        
+    bool symmetricForces = true;
+    bool deterministic = false;
+    std::vector<std::vector<Vec2>> forceAccumulators;
+
+    //      ,    :   i -
+    // pairCache[neighborStart[i], neighborStart[i] + pairCount[i]),     i
+    //   pairUpper[i].         
+    bool pairCacheEnabled = false;
+    PairCacheKernels pairCacheKernels;
+    std::vector<PairEntry> pairCache;
+    std::vector<int> pairCount;
+    std::vector<int> pairUpper;
+
+    //   SPH       
+    SphKernelParams kernelParams;
+    KernelType kernelType = KernelType::Spiky;
+    SimdIsa requestedIsa;
+    SphKernels sphKernels;
+    float selfDensity = 0.0f; // W(0) -     
+    EquationOfState equationOfState = EquationOfState::Linear;
+    float stiffness;
+    std::vector<std::vector<float>> pairScratch; //    ,    
+
+    // Position Based Fluids.          ()
+    Solver solver = Solver::WeaklyCompressible;
+    int solverIterations;
+    IncompressibleKernels incompressibleKernels;
+    std::vector<float> predictedX, predictedY; //   ,  
+    std::vector<float> constraintLambda;
+    std::vector<float> correctionX, correctionY; //  ,   XSPH
+
+    // DFSPH.  kappa   ParticleStore     
+    int maxSolverIterations;
+    float densityErrorTolerance;
+    std::vector<float> divergenceFactor; // alpha_i
+    std::vector<float> kappaIncrement; //  kappa  
+    std::vector<float> velocityBeforeSolveX, velocityBeforeSolveY; //    
+    std::vector<uint8_t> velocityLimited; // 1 -         
+    std::vector<float> particleErrors; //      
+    struct alignas(64) PartialSum {
+        double value = 0.0;
+        float maximum = 0.0f;
+    };
+    std::vector<PartialSum> errorSums; //        PARALLEL_GRAIN 
+    SolverStats solverStats;
+
+    //        -      ,
+    //     grid.particleIndices.     
+    std::vector<ThreadPool::Task> cellTasks;
+
+    //  .         
+    struct alignas(64) MotionLimits {
+        float maxSpeedSq = 0.0f;
+        float maxAccelerationSq = 0.0f;
+    };
+    std::vector<MotionLimits> motionLimits;
+    float safetyFactor;
+    int maxSubsteps;
+    float lastTimeStep = 0.0f;
+    int lastSubsteps = 0;
+    StageTimings stageTimings;
+
+    std::unique_ptr<ThreadPool> threadPool;
 };
 
 #endif
\ No newline at end of file
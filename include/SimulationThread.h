@@ -0,0 +1,49 @@
+#ifndef SIMULATION_THREAD_H
+#define SIMULATION_THREAD_H
+
+#include <atomic>
+#include <thread>
+#include "ParticleSnapshot.h"
+#include "Simulation.h"
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
+#include "Vec2.h"
+
+//  :  Simulation        
+//        .   
+//       ,      .
+//   , Simulation   -    
+class SimulationThread {
+public:
+    struct MouseInput {
+        bool leftPressed = false;
+        Vec2 position;
+    };
+
+    SimulationThread(Simulation& simulation, float step);
+    ~SimulationThread();
+
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    //  .   ,   -    
+    void pushInput(const MouseInput& input);
+
+    //   .     
+    const ParticleSnapshot& acquireSnapshot();
+
+    //  ,    ,    
+    float interpolationAlpha(const ParticleSnapshot& snapshot) const;
+
+private:
+    void run();
+
+    Simulation& simulation;
+    float step;
+    std::atomic<bool> stopping = false;
+    TripleBuffer<ParticleSnapshot> snapshots;
+    SpscQueue<MouseInput, 256> input;
+    std::thread thread;
+};
+
+#endif
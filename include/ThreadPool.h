@@ -0,0 +1,106 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+//      .     
+//   0,    N   N - 1 .
+// parallelFor  parallelTasks       -    
+class ThreadPool {
+public:
+    //   [begin, end).       
+    struct Task {
+        int begin, end;
+    };
+
+    //      
+    struct WorkerStats {
+        double busySeconds = 0.0; //    
+        long long tasks = 0; //  /
+        long long steals = 0; //      
+    };
+
+    explicit ThreadPool(int threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int getThreadCount() const;
+    std::vector<WorkerStats> getWorkerStats() const;
+    void resetWorkerStats();
+
+    //  [0, count)    grainSize   fn(begin, end, thread)  .
+    // fn       std::function,     
+    template <typename Fn>
+    void parallelFor(int count, int grainSize, Fn&& fn) {
+        run(count, grainSize, nullptr, 0, invoker<Fn>(), contextOf(fn));
+    }
+
+    // Work stealing:     ,   
+    //    ,   -    . fn(begin, end, thread)
+    template <typename Fn>
+    void parallelTasks(const std::vector<Task>& tasks, Fn&& fn) {
+        run(0, 1, tasks.data(), static_cast<int>(tasks.size()), invoker<Fn>(), contextOf(fn));
+    }
+
+private:
+    using JobFunction = void (*)(void* context, int begin, int end, int thread);
+
+    template <typename Fn>
+    static JobFunction invoker() {
+        using Callable = std::remove_reference_t<Fn>;
+        return [](void* context, int begin, int end, int thread) {
+            (*static_cast<Callable*>(context))(begin, end, thread);
+        };
+    }
+
+    template <typename Fn>
+    static void* contextOf(Fn& fn) {
+        return const_cast<void*>(static_cast<const void*>(&fn));
+    }
+
+    void run(int count, int grainSize, const Task* tasks, int taskCount, JobFunction function, void* context);
+    void workerLoop(int thread);
+    void runJob(int thread);
+    void runChunks(int thread);
+    void runTasks(int thread);
+    bool popTask(int owner, bool fromBack, int& task);
+    void execute(int begin, int end, int thread, bool stolen);
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable doneCondition;
+    bool stopping = false;
+    unsigned generation = 0; //   ,    
+    int activeWorkers = 0; // ,     
+
+    JobFunction jobFunction = nullptr;
+    void* jobContext = nullptr;
+    int jobCount = 0;
+    int jobGrain = 1;
+    int jobChunks = 0;
+    std::atomic<int> nextChunk{ 0 };
+
+    //   : head  tail    ,   head,
+    //  - tail.   ,   CAS   ABA 
+    struct alignas(64) TaskQueue {
+        std::atomic<uint64_t> range{ 0 };
+    };
+    struct alignas(64) PaddedStats {
+        WorkerStats stats;
+    };
+
+    const Task* jobTasks = nullptr;
+    std::vector<TaskQueue> queues;
+    std::vector<PaddedStats> workerStats;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,41 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+//          .
+//   back()   ,    
+//   update()   front().      :  
+//    ,   ,     , 
+template <typename T>
+class TripleBuffer {
+public:
+    // 
+    T& back() { return buffers[backIndex]; }
+
+    void publish() {
+        int previous = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel);
+        backIndex = previous & INDEX;
+    }
+
+    // . false -   , front()  
+    bool update() {
+        if ((middle.load(std::memory_order_relaxed) & FRESH) == 0) return false;
+        int previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+        frontIndex = previous & INDEX;
+        return true;
+    }
+
+    const T& front() const { return buffers[frontIndex]; }
+
+private:
+    static constexpr int INDEX = 3;
+    static constexpr int FRESH = 4; //       
+
+    T buffers[3];
+    alignas(64) std::atomic<int> middle{ 1 }; //      FRESH
+    alignas(64) int backIndex = 0; //  
+    alignas(64) int frontIndex = 2; //  
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef VEC2_H
+#define VEC2_H
+
+//    .     ,  sf::Vector2f
+//    -   Vec2    
+struct Vec2 {
+    float x = 0.0f;
+    float y = 0.0f;
+
+    Vec2& operator+=(Vec2 other) {
+        x += other.x;
+        y += other.y;
+        return *this;
+    }
+
+    Vec2& operator-=(Vec2 other) {
+        x -= other.x;
+        y -= other.y;
+        return *this;
+    }
+
+    Vec2& operator*=(float scale) {
+        x *= scale;
+        y *= scale;
+        return *this;
+    }
+};
+
+inline Vec2 operator+(Vec2 a, Vec2 b) { return { a.x + b.x, a.y + b.y }; }
+inline Vec2 operator-(Vec2 a, Vec2 b) { return { a.x - b.x, a.y - b.y }; }
+inline Vec2 operator-(Vec2 a) { return { -a.x, -a.y }; }
+inline Vec2 operator*(Vec2 a, float scale) { return { a.x * scale, a.y * scale }; }
+inline Vec2 operator*(float scale, Vec2 a) { return { a.x * scale, a.y * scale }; }
+inline Vec2 operator/(Vec2 a, float scale) { return { a.x / scale, a.y / scale }; }
+
+//    
+struct Vec2i {
+    int x = 0;
+    int y = 0;
+};
+
+#endif
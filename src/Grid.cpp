@@ -0,0 +1,134 @@
+#include "Grid.h"
+
+//  :   32    (x -  , y - )
+static uint64_t spreadBits(uint32_t value) {
+    uint64_t v = value;
+    v = (v | (v << 16)) & 0x0000ffff0000ffffull;
+    v = (v | (v << 8)) & 0x00ff00ff00ff00ffull;
+    v = (v | (v << 4)) & 0x0f0f0f0f0f0f0f0full;
+    v = (v | (v << 2)) & 0x3333333333333333ull;
+    v = (v | (v << 1)) & 0x5555555555555555ull;
+    return v;
+}
+
+static uint64_t interleave(uint32_t x, uint32_t y) {
+    return spreadBits(x) | (spreadBits(y) << 1);
+}
+
+Grid::Grid(Type type, float width, float height, float size) : type(type), cellSize(size) {
+    numCellsX = static_cast<int>(std::ceil(width / cellSize));
+    numCellsY = static_cast<int>(std::ceil(height / cellSize));
+    if (type == Type::Sparse) return;
+
+    int numCells = numCellsX * numCellsY;
+    cellStart.resize(numCells);
+    cellEnd.resize(numCells);
+
+    //            
+    mortonOrder.resize(numCells);
+    for (int c = 0; c < numCells; ++c) mortonOrder[c] = c;
+    std::sort(mortonOrder.begin(), mortonOrder.end(), [this](int a, int b) {
+        return mortonCode(a) < mortonCode(b);
+    });
+}
+
+int Grid::getCellIndex(Vec2 pos) const {
+    int x = static_cast<int>(pos.x / cellSize);
+    int y = static_cast<int>(pos.y / cellSize);
+
+    //     
+    x = std::max(0, std::min(x, numCellsX - 1));
+    y = std::max(0, std::min(y, numCellsY - 1));
+
+    return y * numCellsX + x;
+}
+
+int Grid::insertCell(uint64_t key) {
+    uint64_t slot = hashSlot(key);
+    while (tableCells[slot] >= 0) {
+        if (tableKeys[slot] == key) return tableCells[slot];
+        slot = (slot + 1) & tableMask;
+    }
+
+    int cellIndex = static_cast<int>(cellCoords.size());
+    tableKeys[slot] = key;
+    tableCells[slot] = cellIndex;
+    cellCoords.push_back({ static_cast<int32_t>(key >> 32), static_cast<int32_t>(key & 0xffffffffu) });
+    cellEnd.push_back(0);
+    return cellIndex;
+}
+
+void Grid::build(const ParticleStore& particles) {
+    particleKeys.resize(particles.size());
+    for (size_t i = 0; i < particles.size(); ++i) {
+        particleKeys[i] = particleKey(particles.position(i));
+    }
+    buildFromKeys();
+}
+
+void Grid::buildFromKeys() {
+    int count = static_cast<int>(particleKeys.size());
+    //       
+    particleCells.resize(count);
+    particleIndices.resize(count);
+
+    //  :       (  cellEnd)
+    if (type == Type::Dense) {
+        std::fill(cellEnd.begin(), cellEnd.end(), 0);
+        for (int i = 0; i < count; ++i) {
+            int cellIndex = static_cast<int>(particleKeys[i]);
+            particleCells[i] = cellIndex;
+            ++cellEnd[cellIndex];
+        }
+    }
+    else {
+        //             
+        size_t capacity = 64;
+        while (capacity < 2 * static_cast<size_t>(count)) capacity *= 2;
+        tableKeys.resize(capacity);
+        tableCells.assign(capacity, -1);
+        tableMask = capacity - 1;
+        cellCoords.clear();
+        cellEnd.clear();
+
+        for (int i = 0; i < count; ++i) {
+            int cellIndex = insertCell(particleKeys[i]);
+            particleCells[i] = cellIndex;
+            ++cellEnd[cellIndex];
+        }
+        cellStart.resize(cellEnd.size());
+    }
+
+    //  : cellEnd      
+    int offset = 0;
+    for (size_t c = 0; c < cellStart.size(); ++c) {
+        cellStart[c] = offset;
+        offset += cellEnd[c];
+        cellEnd[c] = cellStart[c];
+    }
+
+    //  :   (   )
+    for (int i = 0; i < count; ++i) {
+        particleIndices[cellEnd[particleCells[i]]++] = i;
+    }
+}
+
+uint64_t Grid::mortonCode(int cellIndex) const {
+    if (type == Type::Dense) {
+        return interleave(cellIndex % numCellsX, cellIndex / numCellsX);
+    }
+    //      int-,    .
+    //           ,  
+    Vec2i coord = cellCoords[cellIndex];
+    return interleave(static_cast<uint32_t>(coord.x) ^ 0x80000000u, static_cast<uint32_t>(coord.y) ^ 0x80000000u);
+}
+
+void Grid::sortCellsByMorton() {
+    if (type == Type::Dense) return;
+
+    mortonOrder.resize(cellCoords.size());
+    for (size_t c = 0; c < mortonOrder.size(); ++c) mortonOrder[c] = static_cast<int>(c);
+    std::sort(mortonOrder.begin(), mortonOrder.end(), [this](int a, int b) {
+        return mortonCode(a) < mortonCode(b);
+    });
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "Profiler.h"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//     .      ,
+//        
+struct ThreadTrace {
+    int threadId;
+    std::vector<Profiler::Event> events;
+    long long written = 0; //  ,    - written % RING_CAPACITY
+};
+
+static std::mutex registryMutex;
+static std::vector<std::unique_ptr<ThreadTrace>> registry;
+
+static ThreadTrace& threadTrace() {
+    thread_local ThreadTrace* trace = nullptr;
+    if (trace == nullptr) {
+        auto created = std::make_unique<ThreadTrace>();
+        created->events.resize(Profiler::RING_CAPACITY);
+        std::lock_guard<std::mutex> lock(registryMutex);
+        created->threadId = static_cast<int>(registry.size());
+        trace = created.get();
+        registry.push_back(std::move(created));
+    }
+    return *trace;
+}
+
+bool Profiler::isEnabled() {
+#ifdef FLUID_PROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+int64_t Profiler::now() {
+    static const auto epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Profiler::record(const Event& event) {
+    ThreadTrace& trace = threadTrace();
+    trace.events[trace.written % RING_CAPACITY] = event;
+    ++trace.written;
+}
+
+bool Profiler::writeChromeTrace(const std::string& path) {
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (file == nullptr) return false;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::fprintf(file, "{\"traceEvents\": [\n");
+    bool first = true;
+    for (const auto& trace : registry) {
+        std::fprintf(file, "%s  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"thread %d\"}}",
+            first ? "" : ",\n", trace->threadId, trace->threadId);
+        first = false;
+
+        //    -   RING_CAPACITY ,    
+        long long begin = trace->written > RING_CAPACITY ? trace->written - RING_CAPACITY : 0;
+        for (long long k = begin; k < trace->written; ++k) {
+            const Event& event = trace->events[k % RING_CAPACITY];
+            std::fprintf(file, ",\n  {\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f, \"args\": {",
+                event.name, trace->threadId, event.begin / 1000.0, (event.end - event.begin) / 1000.0);
+            for (int c = 0; c < event.counterCount; ++c) {
+                std::fprintf(file, "%s\"%s\": %lld", c > 0 ? ", " : "", event.counterNames[c], event.counterValues[c]);
+            }
+            std::fprintf(file, "}}");
+        }
+    }
+    std::fprintf(file, "\n]}\n");
+    return std::fclose(file) == 0;
+}
+
+void Profiler::clear() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto& trace : registry) trace->written = 0;
+}
+
+#ifdef FLUID_PROFILE
+
+static thread_local ProfileZone* currentZone = nullptr;
+
+ProfileZone::ProfileZone(const char* name) : parent(currentZone) {
+    event.name = name;
+    event.counterCount = 0;
+    currentZone = this;
+    event.begin = Profiler::now();
+}
+
+ProfileZone::~ProfileZone() {
+    event.end = Profiler::now();
+    currentZone = parent;
+    Profiler::record(event);
+}
+
+void ProfileZone::counter(const char* name, long long value) {
+    if (event.counterCount == Profiler::MAX_COUNTERS) return;
+    event.counterNames[event.counterCount] = name;
+    event.counterValues[event.counterCount] = value;
+    ++event.counterCount;
+}
+
+ProfileZone* ProfileZone::current() {
+    return currentZone;
+}
+
+#endif
@@ -1,12 +1,29 @@
 #include "Renderer.h"
+#include "Profiler.h"
 
-Renderer::Renderer(sf::RenderWindow& window) : window(window) {}
+constexpr float PARTICLE_SIZE = 4.0f; //     
 
-void Renderer::render(const std::vector<Particle>& particles) {
-    for (const auto& p : particles) {
-        sf::CircleShape circle(2); //  
-        circle.setPosition(p.position);
-        circle.setFillColor(p.color);
-        window.draw(circle);
+Renderer::Renderer(sf::RenderWindow& window) : window(window), vertices(sf::PrimitiveType::Triangles) {}
+
+void Renderer::render(const ParticleSnapshot& particles, float alpha) {
+    FLUID_PROFILE_ZONE("Renderer::render");
+    FLUID_PROFILE_COUNTER("particles", particles.size());
+    vertices.resize(particles.size() * 6);
+    for (size_t i = 0; i < particles.size(); ++i) {
+        sf::Vector2f previous = { particles.previousX[i], particles.previousY[i] };
+        sf::Vector2f current = { particles.x[i], particles.y[i] };
+        sf::Vector2f topLeft = previous + (current - previous) * alpha;
+        sf::Vector2f bottomRight = topLeft + sf::Vector2f(PARTICLE_SIZE, PARTICLE_SIZE);
+
+        sf::Vertex* quad = &vertices[i * 6];
+        quad[0].position = topLeft;
+        quad[1].position = { bottomRight.x, topLeft.y };
+        quad[2].position = { topLeft.x, bottomRight.y };
+        quad[3].position = quad[2].position;
+        quad[4].position = quad[1].position;
+        quad[5].position = bottomRight;
+        const Color& color = particles.color[i];
+        for (int k = 0; k < 6; ++k) quad[k].color = sf::Color(color.r, color.g, color.b, color.a);
     }
+    window.draw(vertices);
 }
\ No newline at end of file
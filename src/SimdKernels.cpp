@@ -0,0 +1,283 @@
+#include "SimdKernels.h"
+#include <cmath>
+#include <numbers>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define FLUID_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC   AVX   
+#define FLUID_TARGET_AVX2
+#define FLUID_TARGET_AVX512
+#else
+// GCC/Clang:       ,   -  
+#define FLUID_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define FLUID_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+#if defined(__GNUC__) && !defined(__clang__)
+//   GCC  _mm512_undefined_ps   
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#else
+#define FLUID_SIMD_X86 0
+#endif
+
+//  :  Spiky W(r) = densityNorm * (h - r)^3   
+// gradientNorm * (h - r)^2 * r / |r|,     makeSphKernelParams
+static float densitySumScalar(const SphParticleArrays& p, int i, const int* neighbors, int count, const SphKernelParams& params) {
+    float density = 0.0f;
+    for (int n = 0; n < count; ++n) {
+        int j = neighbors[n];
+        float distance = std::hypot(p.x[i] - p.x[j], p.y[i] - p.y[j]);
+        if (distance < params.h) {
+            float t = params.h - distance;
+            density += params.densityNorm * t * t * t;
+        }
+    }
+    return density;
+}
+
+static void pairForceScalar(const SphParticleArrays& p, int i, int j, const SphKernelParams& params, float& fx, float& fy) {
+    float rx = p.x[i] - p.x[j];
+    float ry = p.y[i] - p.y[j];
+    float distance = std::hypot(rx, ry);
+    if (distance >= params.h) {
+        fx = fy = 0.0f;
+        return;
+    }
+    float t = params.h - distance;
+
+    // 
+    float pressure = p.pressure[i] + p.pressure[j];
+    float gradientScale = distance > 0.0f ? params.gradientNorm * t * t / distance * pressure : 0.0f;
+
+    // 
+    float viscosityScale = params.viscosity * params.densityNorm * t * t * t;
+
+    fx = rx * gradientScale + (p.vx[j] - p.vx[i]) * viscosityScale;
+    fy = ry * gradientScale + (p.vy[j] - p.vy[i]) * viscosityScale;
+}
+
+static void pairForcesScalar(const SphParticleArrays& p, int i, const int* neighbors, int count, const SphKernelParams& params, float* fx, float* fy) {
+    for (int n = 0; n < count; ++n) {
+        pairForceScalar(p, i, neighbors[n], params, fx[n], fy[n]);
+    }
+}
+
+#if FLUID_SIMD_X86
+
+FLUID_TARGET_AVX2 static float horizontalSum(__m256 v) {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+FLUID_TARGET_AVX2 static float densitySumAvx2(const SphParticleArrays& p, int i, const int* neighbors, int count, const SphKernelParams& params) {
+    const __m256 xi = _mm256_set1_ps(p.x[i]);
+    const __m256 yi = _mm256_set1_ps(p.y[i]);
+    const __m256 h = _mm256_set1_ps(params.h);
+    const __m256 norm = _mm256_set1_ps(params.densityNorm);
+    __m256 sum = _mm256_setzero_ps();
+
+    int n = 0;
+    for (; n + 8 <= count; n += 8) {
+        __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(neighbors + n));
+        __m256 dx = _mm256_sub_ps(xi, _mm256_i32gather_ps(p.x, index, 4));
+        __m256 dy = _mm256_sub_ps(yi, _mm256_i32gather_ps(p.y, index, 4));
+        __m256 distance = _mm256_sqrt_ps(_mm256_fmadd_ps(dx, dx, _mm256_mul_ps(dy, dy)));
+
+        //      
+        __m256 inside = _mm256_cmp_ps(distance, h, _CMP_LT_OQ);
+        __m256 t = _mm256_sub_ps(h, distance);
+        __m256 w = _mm256_mul_ps(_mm256_mul_ps(t, t), _mm256_mul_ps(t, norm));
+        sum = _mm256_add_ps(sum, _mm256_and_ps(inside, w));
+    }
+
+    float density = horizontalSum(sum);
+    //   8 
+    if (n < count) density += densitySumScalar(p, i, neighbors + n, count - n, params);
+    return density;
+}
+
+FLUID_TARGET_AVX2 static void pairForcesAvx2(const SphParticleArrays& p, int i, const int* neighbors, int count, const SphKernelParams& params, float* fx, float* fy) {
+    const __m256 xi = _mm256_set1_ps(p.x[i]);
+    const __m256 yi = _mm256_set1_ps(p.y[i]);
+    const __m256 vxi = _mm256_set1_ps(p.vx[i]);
+    const __m256 vyi = _mm256_set1_ps(p.vy[i]);
+    const __m256 pressureI = _mm256_set1_ps(p.pressure[i]);
+    const __m256 viscosity = _mm256_set1_ps(params.viscosity);
+    const __m256 h = _mm256_set1_ps(params.h);
+    const __m256 densityNorm = _mm256_set1_ps(params.densityNorm);
+    const __m256 gradientNorm = _mm256_set1_ps(params.gradientNorm);
+    const __m256 zero = _mm256_setzero_ps();
+
+    int n = 0;
+    for (; n + 8 <= count; n += 8) {
+        __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(neighbors + n));
+        __m256 dx = _mm256_sub_ps(xi, _mm256_i32gather_ps(p.x, index, 4));
+        __m256 dy = _mm256_sub_ps(yi, _mm256_i32gather_ps(p.y, index, 4));
+        __m256 distance = _mm256_sqrt_ps(_mm256_fmadd_ps(dx, dx, _mm256_mul_ps(dy, dy)));
+
+        //       h,      
+        __m256 inside = _mm256_cmp_ps(distance, h, _CMP_LT_OQ);
+        __m256 hasGradient = _mm256_and_ps(inside, _mm256_cmp_ps(distance, zero, _CMP_GT_OQ));
+
+        __m256 t = _mm256_sub_ps(h, distance);
+        __m256 t2 = _mm256_mul_ps(t, t);
+        __m256 w = _mm256_mul_ps(_mm256_mul_ps(t2, t), densityNorm);
+
+        // : grad W * (p_i + p_j)
+        __m256 pressure = _mm256_add_ps(pressureI, _mm256_i32gather_ps(p.pressure, index, 4));
+        __m256 gradientScale = _mm256_div_ps(_mm256_mul_ps(gradientNorm, t2), distance);
+        gradientScale = _mm256_and_ps(hasGradient, _mm256_mul_ps(gradientScale, pressure));
+
+        // : (v_j - v_i) * mu * W
+        __m256 viscosityScale = _mm256_and_ps(inside, _mm256_mul_ps(viscosity, w));
+        __m256 dvx = _mm256_sub_ps(_mm256_i32gather_ps(p.vx, index, 4), vxi);
+        __m256 dvy = _mm256_sub_ps(_mm256_i32gather_ps(p.vy, index, 4), vyi);
+
+        _mm256_storeu_ps(fx + n, _mm256_fmadd_ps(dx, gradientScale, _mm256_mul_ps(dvx, viscosityScale)));
+        _mm256_storeu_ps(fy + n, _mm256_fmadd_ps(dy, gradientScale, _mm256_mul_ps(dvy, viscosityScale)));
+    }
+
+    //   8 
+    if (n < count) pairForcesScalar(p, i, neighbors + n, count - n, params, fx + n, fy + n);
+}
+
+FLUID_TARGET_AVX512 static float densitySumAvx512(const SphParticleArrays& p, int i, const int* neighbors, int count, const SphKernelParams& params) {
+    const __m512 xi = _mm512_set1_ps(p.x[i]);
+    const __m512 yi = _mm512_set1_ps(p.y[i]);
+    const __m512 h = _mm512_set1_ps(params.h);
+    const __m512 norm = _mm512_set1_ps(params.densityNorm);
+    const __m512 zero = _mm512_setzero_ps();
+    __m512 sum = zero;
+
+    //        
+    for (int n = 0; n < count; n += 16) {
+        int remaining = count - n;
+        __mmask16 lanes = remaining >= 16 ? static_cast<__mmask16>(0xFFFF) : static_cast<__mmask16>((1u << remaining) - 1);
+        __m512i index = _mm512_maskz_loadu_epi32(lanes, neighbors + n);
+        __m512 dx = _mm512_sub_ps(xi, _mm512_mask_i32gather_ps(zero, lanes, index, p.x, 4));
+        __m512 dy = _mm512_sub_ps(yi, _mm512_mask_i32gather_ps(zero, lanes, index, p.y, 4));
+        __m512 distance = _mm512_sqrt_ps(_mm512_fmadd_ps(dx, dx, _mm512_mul_ps(dy, dy)));
+
+        __mmask16 inside = _mm512_mask_cmp_ps_mask(lanes, distance, h, _CMP_LT_OQ);
+        __m512 t = _mm512_sub_ps(h, distance);
+        __m512 w = _mm512_mul_ps(_mm512_mul_ps(t, t), _mm512_mul_ps(t, norm));
+        sum = _mm512_mask_add_ps(sum, inside, sum, w);
+    }
+
+    return _mm512_reduce_add_ps(sum);
+}
+
+FLUID_TARGET_AVX512 static void pairForcesAvx512(const SphParticleArrays& p, int i, const int* neighbors, int count, const SphKernelParams& params, float* fx, float* fy) {
+    const __m512 xi = _mm512_set1_ps(p.x[i]);
+    const __m512 yi = _mm512_set1_ps(p.y[i]);
+    const __m512 vxi = _mm512_set1_ps(p.vx[i]);
+    const __m512 vyi = _mm512_set1_ps(p.vy[i]);
+    const __m512 pressureI = _mm512_set1_ps(p.pressure[i]);
+    const __m512 viscosity = _mm512_set1_ps(params.viscosity);
+    const __m512 h = _mm512_set1_ps(params.h);
+    const __m512 densityNorm = _mm512_set1_ps(params.densityNorm);
+    const __m512 gradientNorm = _mm512_set1_ps(params.gradientNorm);
+    const __m512 zero = _mm512_setzero_ps();
+
+    for (int n = 0; n < count; n += 16) {
+        int remaining = count - n;
+        __mmask16 lanes = remaining >= 16 ? static_cast<__mmask16>(0xFFFF) : static_cast<__mmask16>((1u << remaining) - 1);
+        __m512i index = _mm512_maskz_loadu_epi32(lanes, neighbors + n);
+        __m512 dx = _mm512_sub_ps(xi, _mm512_mask_i32gather_ps(zero, lanes, index, p.x, 4));
+        __m512 dy = _mm512_sub_ps(yi, _mm512_mask_i32gather_ps(zero, lanes, index, p.y, 4));
+        __m512 distance = _mm512_sqrt_ps(_mm512_fmadd_ps(dx, dx, _mm512_mul_ps(dy, dy)));
+
+        //       h,      
+        __mmask16 inside = _mm512_mask_cmp_ps_mask(lanes, distance, h, _CMP_LT_OQ);
+        __mmask16 hasGradient = _mm512_mask_cmp_ps_mask(inside, distance, zero, _CMP_GT_OQ);
+
+        __m512 t = _mm512_sub_ps(h, distance);
+        __m512 t2 = _mm512_mul_ps(t, t);
+        __m512 w = _mm512_mul_ps(_mm512_mul_ps(t2, t), densityNorm);
+
+        // : grad W * (p_i + p_j)
+        __m512 neighborPressure = _mm512_mask_i32gather_ps(zero, lanes, index, p.pressure, 4);
+        __m512 pressure = _mm512_add_ps(pressureI, neighborPressure);
+        __m512 gradientScale = _mm512_maskz_div_ps(hasGradient, _mm512_mul_ps(gradientNorm, t2), distance);
+        gradientScale = _mm512_mul_ps(gradientScale, pressure);
+
+        // : (v_j - v_i) * mu * W
+        __m512 viscosityScale = _mm512_maskz_mul_ps(inside, viscosity, w);
+        __m512 dvx = _mm512_sub_ps(_mm512_mask_i32gather_ps(zero, lanes, index, p.vx, 4), vxi);
+        __m512 dvy = _mm512_sub_ps(_mm512_mask_i32gather_ps(zero, lanes, index, p.vy, 4), vyi);
+
+        _mm512_mask_storeu_ps(fx + n, lanes, _mm512_fmadd_ps(dx, gradientScale, _mm512_mul_ps(dvx, viscosityScale)));
+        _mm512_mask_storeu_ps(fy + n, lanes, _mm512_fmadd_ps(dy, gradientScale, _mm512_mul_ps(dvy, viscosityScale)));
+    }
+}
+
+#endif
+
+SimdIsa detectSimdIsa() {
+#if FLUID_SIMD_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return SimdIsa::Scalar;
+
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    if (!osxsave) return SimdIsa::Scalar;
+
+    //     YMM ( 1-2 XCR0)  ZMM ( 5-7)
+    unsigned long long xcr0 = _xgetbv(0);
+    bool ymmEnabled = (xcr0 & 0x6) == 0x6;
+    bool zmmEnabled = (xcr0 & 0xE6) == 0xE6;
+
+    __cpuidex(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0;
+    bool avx512f = (info[1] & (1 << 16)) != 0;
+
+    if (avx512f && zmmEnabled) return SimdIsa::Avx512;
+    if (avx2 && fma && ymmEnabled) return SimdIsa::Avx2;
+#else
+    //   GCC/Clang       
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SimdIsa::Avx512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SimdIsa::Avx2;
+#endif
+#endif
+    return SimdIsa::Scalar;
+}
+
+const char* simdIsaName(SimdIsa isa) {
+    switch (isa) {
+    case SimdIsa::Avx2: return "avx2";
+    case SimdIsa::Avx512: return "avx512";
+    default: return "scalar";
+    }
+}
+
+SphKernelParams makeSphKernelParams(float h, float viscosity) {
+    //    ,      
+    double h5 = std::pow(static_cast<double>(h), 5);
+    SphKernelParams params;
+    params.h = h;
+    params.densityNorm = static_cast<float>(6.0 / (std::numbers::pi * h5));
+    params.gradientNorm = static_cast<float>(-3.0 / (std::numbers::pi * h5));
+    params.viscosity = viscosity;
+    return params;
+}
+
+SphKernels selectSphKernels(SimdIsa isa) {
+    SimdIsa supported = detectSimdIsa();
+    if (static_cast<int>(isa) > static_cast<int>(supported)) isa = supported;
+
+#if FLUID_SIMD_X86
+    if (isa == SimdIsa::Avx512) return { isa, densitySumAvx512, pairForcesAvx512 };
+    if (isa == SimdIsa::Avx2) return { isa, densitySumAvx2, pairForcesAvx2 };
+#endif
+    return { SimdIsa::Scalar, densitySumScalar, pairForcesScalar };
+}
\ No newline at end of file
@@ -1,7 +1,13 @@
 #include "Simulation.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
 #include <cmath>
 #include <iostream>
 #include <numbers>
+#include <thread>
 
 // 
 constexpr float GRAVITY = 9.81f; //   
@@ -10,218 +16,1330 @@ constexpr float PARTICLE_RADIUS = 5.0f; // 
 constexpr float KERNEL_RADIUS = 20.0f; //   ( SPH)
 constexpr float REST_DENSITY = 1000.0f; //     (, )
 constexpr float PRESSURE_CONSTANT = 100.0f; //    
+constexpr float TAIT_EXPONENT = 7.0f; //  gamma   ()
 constexpr float VISCOSITY_CONSTANT = 0.1f; //   
+constexpr float NEIGHBOR_SKIN = 5.0f; //      
+constexpr int PARALLEL_GRAIN = 256; //       
+constexpr int TASKS_PER_THREAD = 8; //        work stealing
+constexpr float CFL_SAFETY_FACTOR = 0.4f; //   ,     
+constexpr int MAX_SUBSTEPS = 8; //     
+constexpr float REORDER_DISORDER_THRESHOLD = 0.1f; //   ,   
+constexpr float GRAVITY_ACCELERATION = GRAVITY * 100.0f; //     PBF  DFSPH, 100   
+constexpr float REST_SPACING = 8.0f; //       PBF  DFSPH
+constexpr float PBF_RELAXATION = 1.0f; //   -   |grad C|^2  
+constexpr float PBF_MAX_CORRECTION = 0.125f * REST_SPACING; //      
+constexpr float XSPH_VISCOSITY = 0.01f; //  c  XSPH
+constexpr int PBF_ITERATIONS = 8; //     .  4   50   
+constexpr float MAX_TIME_STEP = 1.0f / 60.0f; //    PBF
+constexpr float DFSPH_MAX_TIME_STEP = 1.0f / 120.0f; //    DFSPH
+constexpr int DFSPH_MAX_ITERATIONS = 100; //     DFSPH  
+constexpr float DFSPH_DENSITY_TOLERANCE = 0.001f; //    , 0.1%
+constexpr float DFSPH_MAX_ERROR_RATIO = 10.0f; //     -     
+constexpr uint64_t SPAWN_SEED = 12345; //     
+constexpr float DFSPH_FACTOR_EPSILON = 1e-3f; //  alpha      -    
 
-//      (Spiky Kernel)
-float kernel(float distance, float h) {
-    if (distance >= h) return 0.0f;
-    float volume = (std::numbers::pi * std::pow(h, 5)) / 6.0f;
-    return std::pow(h - distance, 3) / volume;
+using Clock = std::chrono::steady_clock;
+
+static double secondsBetween(Clock::time_point begin, Clock::time_point end) {
+    return std::chrono::duration<double>(end - begin).count();
 }
 
-//      (Spiky Kernel Gradient)
-sf::Vector2f kernelGradient(sf::Vector2f r, float h) {
-    float distance = std::hypot(r.x, r.y);
-    if (distance >= h || distance == 0.0f) return { 0.0f, 0.0f };
-    float scale = -3.0f * std::pow(h - distance, 2) / (std::numbers::pi * std::pow(h, 5));
-    return { r.x * scale / distance, r.y * scale / distance };
+//       -  Kernels.h.  
+//  SimdKernels.h,    -       
+template <typename Kernel>
+static float densitySumKernel(const SphParticleArrays& p, int i, const int* neighbors, int count, const SphKernelParams&) {
+    float density = 0.0f;
+    for (int n = 0; n < count; ++n) {
+        int j = neighbors[n];
+        float dx = p.x[i] - p.x[j];
+        float dy = p.y[i] - p.y[j];
+        density += Kernel::value(dx * dx + dy * dy);
+    }
+    return density;
 }
 
-//  Uniform Grid
-Simulation::Grid::Grid(int w, int h, float size) : width(w), height(h), cellSize(size) {
-    int numCellsX = static_cast<int>(std::ceil(width / cellSize));
-    int numCellsY = static_cast<int>(std::ceil(height / cellSize));
-    cells.resize(numCellsX * numCellsY);
+template <typename Kernel>
+static void pairForcesKernel(const SphParticleArrays& p, int i, const int* neighbors, int count, const SphKernelParams& params, float* fx, float* fy) {
+    for (int n = 0; n < count; ++n) {
+        int j = neighbors[n];
+        float rx = p.x[i] - p.x[j];
+        float ry = p.y[i] - p.y[j];
+        float r2 = rx * rx + ry * ry;
+
+        //   ,   SimdKernels.cpp
+        float gradientScale = Kernel::gradientFactor(r2) * (p.pressure[i] + p.pressure[j]);
+        float viscosityScale = params.viscosity * Kernel::value(r2);
+        fx[n] = rx * gradientScale + (p.vx[j] - p.vx[i]) * viscosityScale;
+        fy[n] = ry * gradientScale + (p.vy[j] - p.vy[i]) * viscosityScale;
+    }
 }
 
-int Simulation::Grid::getCellIndex(sf::Vector2f pos) const {
-    int x = static_cast<int>(pos.x / cellSize);
-    int y = static_cast<int>(pos.y / cellSize);
-    int numCellsX = static_cast<int>(std::ceil(width / cellSize));
-    int numCellsY = static_cast<int>(std::ceil(height / cellSize));
+template <typename Kernel>
+static SphKernels policyKernels() {
+    return { SimdIsa::Scalar, densitySumKernel<Kernel>, pairForcesKernel<Kernel> };
+}
 
-    //     
-    x = std::max(0, std::min(x, numCellsX - 1));
-    y = std::max(0, std::min(y, numCellsY - 1));
+//   .       -    
+template <typename Kernel>
+static float densityEmitKernel(const SphParticleArrays& p, int i, const int* neighbors, int count, PairEntry* pairs, int& pairCount) {
+    float density = 0.0f;
+    int emitted = 0;
+    for (int n = 0; n < count; ++n) {
+        int j = neighbors[n];
+        float rx = p.x[i] - p.x[j];
+        float ry = p.y[i] - p.y[j];
+        float r2 = rx * rx + ry * ry;
 
-    return y * numCellsX + x;
+        //   :   h  ,     
+        bool inside = r2 < Kernel::radius * Kernel::radius;
+        float distance = std::sqrt(r2);
+        float inverse = distance > 0.0f ? 1.0f / distance : 0.0f;
+        pairs[emitted] = { j, distance, rx * inverse, ry * inverse };
+        emitted += inside;
+        density += inside ? Kernel::valueAt(distance) : 0.0f;
+    }
+    pairCount = emitted;
+    return density;
 }
 
-void Simulation::Grid::addParticle(int particleIndex, sf::Vector2f pos) {
-    cells[getCellIndex(pos)].push_back(particleIndex);
+template <typename Kernel>
+static void cachedPairForcesKernel(const SphParticleArrays& p, int i, const PairEntry* pairs, int count, const SphKernelParams& params, float* fx, float* fy) {
+    for (int n = 0; n < count; ++n) {
+        const PairEntry& pair = pairs[n];
+        int j = pair.neighbor;
+        float gradientScale = Kernel::derivativeAt(pair.distance) * (p.pressure[i] + p.pressure[j]);
+        float viscosityScale = params.viscosity * Kernel::valueAt(pair.distance);
+        fx[n] = pair.directionX * gradientScale + (p.vx[j] - p.vx[i]) * viscosityScale;
+        fy[n] = pair.directionY * gradientScale + (p.vy[j] - p.vy[i]) * viscosityScale;
+    }
 }
 
-void Simulation::Grid::clear() {
-    for (auto& cell : cells) cell.clear();
+template <typename Kernel>
+static PairCacheKernels makePairCacheKernels() {
+    return { densityEmitKernel<Kernel>, cachedPairForcesKernel<Kernel> };
 }
 
-std::vector<int> Simulation::Grid::getNeighbors(sf::Vector2f pos) const {
-    std::vector<int> neighbors;
-    int x = static_cast<int>(pos.x / cellSize);
-    int y = static_cast<int>(pos.y / cellSize);
-    int numCellsX = static_cast<int>(std::ceil(width / cellSize));
-    int numCellsY = static_cast<int>(std::ceil(height / cellSize));
+//  PBF -  ,    -
+template <typename Kernel>
+static float constraintLambdaKernel(const SphParticleArrays& p, int i, const int* neighbors, int count, float restDensity, float relaxation, float& density) {
+    float rho = Kernel::value(0.0f);
+    float gradientX = 0.0f, gradientY = 0.0f; // grad_i C_i
+    float gradientSq = 0.0f; // sum |grad_j C_i|^2
+    for (int n = 0; n < count; ++n) {
+        int j = neighbors[n];
+        float rx = p.x[i] - p.x[j];
+        float ry = p.y[i] - p.y[j];
+        float r2 = rx * rx + ry * ry;
+        rho += Kernel::value(r2);
+        float g = Kernel::gradientFactor(r2) / restDensity;
+        gradientX += rx * g;
+        gradientY += ry * g;
+        gradientSq += r2 * g * g;
+    }
+    density = rho;
 
-    for (int i = -1; i <= 1; ++i) {
-        for (int j = -1; j <= 1; ++j) {
-            int cellX = x + i;
-            int cellY = y + j;
+    //  :     
+    float constraint = std::max(rho / restDensity - 1.0f, 0.0f);
+    return -constraint / (gradientSq + gradientX * gradientX + gradientY * gradientY + relaxation);
+}
 
-            // ,      
-            if (cellX >= 0 && cellX < numCellsX && cellY >= 0 && cellY < numCellsY) {
-                int cellIndex = cellY * numCellsX + cellX;
-                for (int particleIndex : cells[cellIndex]) {
-                    neighbors.push_back(particleIndex);
-                }
-            }
+template <typename Kernel>
+static void positionCorrectionKernel(const SphParticleArrays& p, const float* lambda, int i, const int* neighbors, int count, float restDensity, float& dx, float& dy) {
+    float sumX = 0.0f, sumY = 0.0f;
+    for (int n = 0; n < count; ++n) {
+        int j = neighbors[n];
+        float rx = p.x[i] - p.x[j];
+        float ry = p.y[i] - p.y[j];
+        float scale = (lambda[i] + lambda[j]) * Kernel::gradientFactor(rx * rx + ry * ry);
+        sumX += rx * scale;
+        sumY += ry * scale;
+    }
+    dx = sumX / restDensity;
+    dy = sumY / restDensity;
+
+    //           ,
+    //        -   
+    float lengthSq = dx * dx + dy * dy;
+    if (lengthSq > PBF_MAX_CORRECTION * PBF_MAX_CORRECTION) {
+        float scale = PBF_MAX_CORRECTION / std::sqrt(lengthSq);
+        dx *= scale;
+        dy *= scale;
+    }
+}
+
+template <typename Kernel>
+static void xsphVelocityKernel(const SphParticleArrays& p, int i, const int* neighbors, int count, float viscosity, float& dvx, float& dvy) {
+    float sumX = 0.0f, sumY = 0.0f;
+    for (int n = 0; n < count; ++n) {
+        int j = neighbors[n];
+        float rx = p.x[i] - p.x[j];
+        float ry = p.y[i] - p.y[j];
+        float weight = Kernel::value(rx * rx + ry * ry) / p.density[j];
+        sumX += (p.vx[j] - p.vx[i]) * weight;
+        sumY += (p.vy[j] - p.vy[i]) * weight;
+    }
+    dvx = viscosity * sumX;
+    dvy = viscosity * sumY;
+}
+
+//  DFSPH.   1,   -   W
+template <typename Kernel>
+static float divergenceFactorKernel(const SphParticleArrays& p, int i, const int* neighbors, int count, float minDenominator, float& density) {
+    float rho = Kernel::value(0.0f);
+    float gradientX = 0.0f, gradientY = 0.0f;
+    float gradientSq = 0.0f;
+    for (int n = 0; n < count; ++n) {
+        int j = neighbors[n];
+        float rx = p.x[i] - p.x[j];
+        float ry = p.y[i] - p.y[j];
+        float r2 = rx * rx + ry * ry;
+        rho += Kernel::value(r2);
+        float g = Kernel::gradientFactor(r2);
+        gradientX += rx * g;
+        gradientY += ry * g;
+        gradientSq += r2 * g * g;
+    }
+    density = rho;
+
+    float denominator = gradientSq + gradientX * gradientX + gradientY * gradientY;
+    return denominator > minDenominator ? 1.0f / denominator : 0.0f;
+}
+
+template <typename Kernel>
+static float densityChangeRateKernel(const SphParticleArrays& p, int i, const int* neighbors, int count) {
+    float rate = 0.0f;
+    for (int n = 0; n < count; ++n) {
+        int j = neighbors[n];
+        float rx = p.x[i] - p.x[j];
+        float ry = p.y[i] - p.y[j];
+        float g = Kernel::gradientFactor(rx * rx + ry * ry);
+        rate += ((p.vx[i] - p.vx[j]) * rx + (p.vy[i] - p.vy[j]) * ry) * g;
+    }
+    return rate;
+}
+
+template <typename Kernel>
+static void pressureAccelerationKernel(const SphParticleArrays& p, const float* kappa, int i, const int* neighbors, int count, float& ax, float& ay) {
+    float sumX = 0.0f, sumY = 0.0f;
+    for (int n = 0; n < count; ++n) {
+        int j = neighbors[n];
+        float rx = p.x[i] - p.x[j];
+        float ry = p.y[i] - p.y[j];
+        float scale = (kappa[i] + kappa[j]) * Kernel::gradientFactor(rx * rx + ry * ry);
+        sumX += rx * scale;
+        sumY += ry * scale;
+    }
+    ax = -sumX;
+    ay = -sumY;
+}
+
+//   -      REST_SPACING,  PBF
+//  DFSPH     .    |grad W|^2  - 
+//   PBF   alpha  DFSPH
+template <typename Kernel>
+static IncompressibleKernels makeIncompressibleKernels() {
+    int reach = static_cast<int>(Kernel::radius / REST_SPACING);
+    float restDensity = 0.0f;
+    float gradientSq = 0.0f;
+    for (int a = -reach; a <= reach; ++a) {
+        for (int b = -reach; b <= reach; ++b) {
+            float r2 = (a * a + b * b) * REST_SPACING * REST_SPACING;
+            float g = Kernel::gradientFactor(r2);
+            restDensity += Kernel::value(r2);
+            gradientSq += r2 * g * g;
         }
     }
 
-    return neighbors;
+    return { restDensity, gradientSq, PBF_RELAXATION * gradientSq / (restDensity * restDensity),
+        constraintLambdaKernel<Kernel>, positionCorrectionKernel<Kernel>, xsphVelocityKernel<Kernel>,
+        divergenceFactorKernel<Kernel>, densityChangeRateKernel<Kernel>, pressureAccelerationKernel<Kernel> };
 }
 
 //  
-Simulation::Simulation() : grid(1024, 768, KERNEL_RADIUS) {}
+Simulation::Simulation(float width, float height, Grid::Type gridType)
+    : width(width), height(height), grid(gridType, width, height, KERNEL_RADIUS + NEIGHBOR_SKIN), spawnSeed(SPAWN_SEED),
+      neighborSkin(NEIGHBOR_SKIN), kernelParams(makeSphKernelParams(KERNEL_RADIUS, VISCOSITY_CONSTANT)),
+      requestedIsa(detectSimdIsa()), stiffness(PRESSURE_CONSTANT), solverIterations(PBF_ITERATIONS),
+      maxSolverIterations(DFSPH_MAX_ITERATIONS), densityErrorTolerance(DFSPH_DENSITY_TOLERANCE), safetyFactor(CFL_SAFETY_FACTOR), maxSubsteps(MAX_SUBSTEPS) {
+    selectKernels();
+    setThreadCount(static_cast<int>(std::thread::hardware_concurrency()));
+}
 
-void Simulation::update(float dt, bool isLeftMousePressed, sf::Vector2f mousePosition) {
+void Simulation::update(float frameTime, bool isLeftMousePressed, Vec2 mousePosition) {
+    FLUID_PROFILE_ZONE("Simulation::update");
     if (isLeftMousePressed) {
-        //       
-        for (int i = 0; i < MAX_PARTICLES_PER_FRAME; ++i) {
-            float angle = static_cast<float>(rand()) / RAND_MAX * 2 * std::numbers::pi; //  
-            float radius = static_cast<float>(rand()) / RAND_MAX * SPAWN_RADIUS; //  
-            sf::Vector2f offset(radius * std::cos(angle), radius * std::sin(angle));
-            sf::Vector2f spawnPosition = mousePosition + offset;
+        //       ,   
+        emitParticles(mousePosition, SPAWN_RADIUS, { 0.0f, 100.0f }, Color::Blue, MAX_PARTICLES_PER_FRAME);
+    }
 
-            Particle p;
-            p.position = spawnPosition;
-            p.velocity = { 0.0f, 100.0f }; //   
-            p.color = sf::Color::Blue; //  
-            particles.push_back(p);
+    //      .   
+    //      
+    particles.previousX = particles.x;
+    particles.previousY = particles.y;
+
+    if (solver == Solver::PositionBased) {
+        // PBF     :      MAX_TIME_STEP
+        int steps = std::min(static_cast<int>(std::ceil(frameTime / MAX_TIME_STEP - 1e-3f)), maxSubsteps);
+        if (frameTime > 0.0f) steps = std::max(steps, 1);
+        for (int s = 0; s < steps; ++s) {
+            stepPositionBased(frameTime / steps);
         }
+        lastTimeStep = steps > 0 ? frameTime / steps : 0.0f;
+        lastSubsteps = steps;
+        return;
     }
 
-    updateGrid();
+    //      :       
+    float remaining = frameTime;
+    lastSubsteps = 0;
+    while (remaining > 0.0f) {
+        float steps = lastSubsteps + 1 < maxSubsteps ? std::ceil(remaining / stableTimeStep()) : 1.0f;
+        float dt = steps > 1.0f ? remaining / steps : remaining;
+        if (solver == Solver::DivergenceFree) {
+            stepDivergenceFree(dt);
+        }
+        else {
+            step(dt);
+        }
+        remaining = steps > 1.0f ? remaining - dt : 0.0f;
+        lastTimeStep = dt;
+        ++lastSubsteps;
+    }
+}
+
+void Simulation::step(float dt) {
+    auto start = Clock::now();
+    updateNeighbors();
+    auto neighborsDone = Clock::now();
     updateDensity();
-    updateForces(dt);
-    integrate(dt);
-    handleBoundaryCollisions();
+    auto densityDone = Clock::now();
+    updatePressure();
+    auto pressureDone = Clock::now();
+    updateForces();
+    auto forcesDone = Clock::now();
+    advanceParticles(dt);
+    auto advanceDone = Clock::now();
+
+    ++stageTimings.steps;
+    stageTimings.neighbors += secondsBetween(start, neighborsDone);
+    stageTimings.density += secondsBetween(neighborsDone, densityDone);
+    stageTimings.pressure += secondsBetween(densityDone, pressureDone);
+    stageTimings.forces += secondsBetween(pressureDone, forcesDone);
+    stageTimings.advance += secondsBetween(forcesDone, advanceDone);
+}
+
+//  PBF:  ,     ,
+//   ,   
+void Simulation::stepPositionBased(float dt) {
+    auto start = Clock::now();
+    predictPositions(dt);
+    auto predictDone = Clock::now();
+    updateNeighbors();
+    auto neighborsDone = Clock::now();
+    solveDensityConstraints();
+    auto solverDone = Clock::now();
+    updatePositionBasedVelocities(dt);
+    auto velocitiesDone = Clock::now();
+
+    ++stageTimings.steps;
+    stageTimings.neighbors += secondsBetween(predictDone, neighborsDone);
+    stageTimings.solver += secondsBetween(neighborsDone, solverDone);
+    stageTimings.advance += secondsBetween(start, predictDone) + secondsBetween(solverDone, velocitiesDone);
+
+    ++solverStats.steps;
+    solverStats.densityIterations += solverIterations;
+    solverStats.lastDensityIterations = solverIterations;
+}
+
+//  DFSPH (Bender, Koschier):   alpha   ,  ,
+//   ,     , 
+void Simulation::stepDivergenceFree(float dt) {
+    auto start = Clock::now();
+    updateNeighbors();
+    auto neighborsDone = Clock::now();
+    computeDivergenceFactors();
+    auto densityDone = Clock::now();
+    float divergenceError = 0.0f, maxDivergenceError = 0.0f;
+    int divergenceIterations = solvePressure(particles.divergencePressure, false, dt, divergenceError, maxDivergenceError);
+    auto divergenceDone = Clock::now();
+    applyNonPressureForces(dt);
+    auto forcesDone = Clock::now();
+    float densityError = 0.0f, maxDensityError = 0.0f;
+    int densityIterations = solvePressure(particles.pressure, true, dt, densityError, maxDensityError);
+    auto solverDone = Clock::now();
+    advancePositions(dt);
+    auto advanceDone = Clock::now();
+
+    ++stageTimings.steps;
+    stageTimings.neighbors += secondsBetween(start, neighborsDone);
+    stageTimings.density += secondsBetween(neighborsDone, densityDone);
+    stageTimings.solver += secondsBetween(densityDone, divergenceDone) + secondsBetween(forcesDone, solverDone);
+    stageTimings.forces += secondsBetween(divergenceDone, forcesDone);
+    stageTimings.advance += secondsBetween(solverDone, advanceDone);
+
+    ++solverStats.steps;
+    solverStats.densityIterations += densityIterations;
+    solverStats.divergenceIterations += divergenceIterations;
+    solverStats.lastDensityIterations = densityIterations;
+    solverStats.lastDivergenceIterations = divergenceIterations;
+    solverStats.lastDensityError = densityError;
+    solverStats.lastMaxDensityError = maxDensityError;
+}
+
+const Simulation::StageTimings& Simulation::getStageTimings() const {
+    return stageTimings;
+}
+
+void Simulation::resetStageTimings() {
+    stageTimings = StageTimings();
+}
+
+void Simulation::setSafetyFactor(float factor) {
+    safetyFactor = factor;
+}
+
+void Simulation::setMaxSubsteps(int substeps) {
+    maxSubsteps = std::max(substeps, 1);
+}
+
+float Simulation::getLastTimeStep() const {
+    return lastTimeStep;
+}
+
+int Simulation::getLastSubsteps() const {
+    return lastSubsteps;
+}
+
+float Simulation::stableTimeStep() const {
+    float maxSpeedSq = 0.0f;
+    float maxAccelerationSq = 0.0f;
+    for (const auto& limits : motionLimits) {
+        maxSpeedSq = std::max(maxSpeedSq, limits.maxSpeedSq);
+        maxAccelerationSq = std::max(maxAccelerationSq, limits.maxAccelerationSq);
+    }
+
+    float h = KERNEL_RADIUS;
+    if (solver == Solver::DivergenceFree) {
+        //   -   CFL  .   ,   PBF:
+        //  1/60      100      50   ,
+        //  kappa     ,   
+        float limit = maxSpeedSq > 0.0f ? safetyFactor * h / std::sqrt(maxSpeedSq) : DFSPH_MAX_TIME_STEP;
+        return std::min(limit, DFSPH_MAX_TIME_STEP);
+    }
+
+    //  ,  CFL      
+    float limit = h * h / VISCOSITY_CONSTANT;
+    if (maxSpeedSq > 0.0f) limit = std::min(limit, h / std::sqrt(maxSpeedSq));
+    if (maxAccelerationSq > 0.0f) limit = std::min(limit, std::sqrt(h / std::sqrt(maxAccelerationSq)));
+    return safetyFactor * limit;
 }
 
-const std::vector<Particle>& Simulation::getParticles() const {
+const ParticleStore& Simulation::getParticles() const {
     return particles;
 }
 
-void Simulation::spawnParticles(sf::Vector2f position, sf::Color color) {
+void Simulation::addParticle(const Particle& particle) {
+    particles.add(particle);
+}
+
+void Simulation::spawnParticles(Vec2 position, Color color) {
     //     
-    position.x = std::max(0.0f, std::min(position.x, 1024.0f));
-    position.y = std::max(0.0f, std::min(position.y, 768.0f));
+    position.x = std::max(0.0f, std::min(position.x, width));
+    position.y = std::max(0.0f, std::min(position.y, height));
 
+    Xoshiro128 rng(spawnSeed, spawnCalls++ << 32);
     for (int i = 0; i < 10; ++i) {
         Particle p;
         //      
-        p.position.x = position.x + (rand() % 10 - 5); //   -5  +5
+        p.position.x = position.x + rng.uniformInt(-5, 4); //   -5  +4
         p.position.y = position.y;
         //   
         p.velocity = { 0.0f, 100.0f }; //  
         p.color = color;
-        particles.push_back(p);
+        particles.add(p);
+    }
+}
+
+void Simulation::setDeterministic(bool enabled) {
+    deterministic = enabled;
+}
+
+bool Simulation::isDeterministic() const {
+    return deterministic;
+}
+
+void Simulation::setSeed(uint64_t seed) {
+    spawnSeed = seed;
+    spawnCalls = 0;
+}
+
+uint64_t Simulation::getStateChecksum() const {
+    // FNV-1a  32- .  ,   :   -0  0,   NaN
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const std::vector<float>& values) {
+        for (float value : values) {
+            hash ^= std::bit_cast<uint32_t>(value);
+            hash *= 1099511628211ull;
+        }
+    };
+    mix(particles.x);
+    mix(particles.y);
+    mix(particles.vx);
+    mix(particles.vy);
+    return hash;
+}
+
+void Simulation::emitParticles(Vec2 center, float radius, Vec2 velocity, Color color, int count) {
+    if (count <= 0) return;
+    size_t first = particles.size();
+    particles.resize(first + count);
+    uint64_t stream = spawnCalls++ << 32;
+
+    threadPool->parallelFor(count, PARALLEL_GRAIN, [&](int begin, int end, int) {
+        //   :        
+        Xoshiro128 rng;
+        for (int k = begin; k < end; ++k) {
+            if (k % PARALLEL_GRAIN == 0) rng = Xoshiro128(spawnSeed, stream + k / PARALLEL_GRAIN);
+            //    
+            float angle = rng.uniform(0.0f, 2.0f * std::numbers::pi_v<float>);
+            float distance = rng.uniform(0.0f, radius);
+            size_t i = first + k;
+            particles.x[i] = particles.previousX[i] = center.x + distance * std::cos(angle);
+            particles.y[i] = particles.previousY[i] = center.y + distance * std::sin(angle);
+            particles.vx[i] = velocity.x;
+            particles.vy[i] = velocity.y;
+            particles.color[i] = color;
+        }
+    });
+}
+
+void Simulation::setThreadCount(int threads) {
+    threadPool = std::make_unique<ThreadPool>(std::max(threads, 1));
+    lastBuildPositions.clear(); //      
+}
+
+int Simulation::getThreadCount() const {
+    return threadPool->getThreadCount();
+}
+
+void Simulation::setSimdIsa(SimdIsa isa) {
+    requestedIsa = isa;
+    selectKernels();
+}
+
+SimdIsa Simulation::getSimdIsa() const {
+    return sphKernels.isa;
+}
+
+void Simulation::setKernel(KernelType type) {
+    kernelType = type;
+    selectKernels();
+}
+
+KernelType Simulation::getKernel() const {
+    return kernelType;
+}
+
+void Simulation::selectKernels() {
+    switch (kernelType) {
+    case KernelType::Poly6:
+        sphKernels = policyKernels<Poly6Kernel<KERNEL_RADIUS>>();
+        pairCacheKernels = makePairCacheKernels<Poly6Kernel<KERNEL_RADIUS>>();
+        incompressibleKernels = makeIncompressibleKernels<Poly6Kernel<KERNEL_RADIUS>>();
+        selfDensity = Poly6Kernel<KERNEL_RADIUS>::value(0.0f);
+        break;
+    case KernelType::WendlandC2:
+        sphKernels = policyKernels<WendlandC2Kernel<KERNEL_RADIUS>>();
+        pairCacheKernels = makePairCacheKernels<WendlandC2Kernel<KERNEL_RADIUS>>();
+        incompressibleKernels = makeIncompressibleKernels<WendlandC2Kernel<KERNEL_RADIUS>>();
+        selfDensity = WendlandC2Kernel<KERNEL_RADIUS>::value(0.0f);
+        break;
+    case KernelType::CubicSpline:
+        sphKernels = policyKernels<CubicSplineKernel<KERNEL_RADIUS>>();
+        pairCacheKernels = makePairCacheKernels<CubicSplineKernel<KERNEL_RADIUS>>();
+        incompressibleKernels = makeIncompressibleKernels<CubicSplineKernel<KERNEL_RADIUS>>();
+        selfDensity = CubicSplineKernel<KERNEL_RADIUS>::value(0.0f);
+        break;
+    default:
+        // Spiky -     
+        sphKernels = selectSphKernels(requestedIsa);
+        pairCacheKernels = makePairCacheKernels<SpikyKernel<KERNEL_RADIUS>>();
+        incompressibleKernels = makeIncompressibleKernels<SpikyExactGradientKernel<KERNEL_RADIUS>>();
+        selfDensity = SpikyKernel<KERNEL_RADIUS>::value(0.0f);
+        break;
+    }
+}
+
+void Simulation::setSolver(Solver value) {
+    solver = value;
+    //  pressure     :   DFSPH   
+    std::fill(particles.pressure.begin(), particles.pressure.end(), 0.0f);
+    std::fill(particles.divergencePressure.begin(), particles.divergencePressure.end(), 0.0f);
+    motionLimits.clear();
+}
+
+Simulation::Solver Simulation::getSolver() const {
+    return solver;
+}
+
+void Simulation::setSolverIterations(int iterations) {
+    solverIterations = std::max(iterations, 1);
+}
+
+int Simulation::getSolverIterations() const {
+    return solverIterations;
+}
+
+void Simulation::setMaxSolverIterations(int iterations) {
+    maxSolverIterations = std::max(iterations, 1);
+}
+
+int Simulation::getMaxSolverIterations() const {
+    return maxSolverIterations;
+}
+
+void Simulation::setDensityErrorTolerance(float tolerance) {
+    densityErrorTolerance = tolerance;
+}
+
+float Simulation::getDensityErrorTolerance() const {
+    return densityErrorTolerance;
+}
+
+const Simulation::SolverStats& Simulation::getSolverStats() const {
+    return solverStats;
+}
+
+void Simulation::resetSolverStats() {
+    solverStats = SolverStats();
+}
+
+SphParticleArrays Simulation::particleArrays() const {
+    return { particles.x.data(), particles.y.data(), particles.vx.data(), particles.vy.data(), particles.density.data(), particles.pressure.data() };
+}
+
+void Simulation::setNeighborSkin(float skin) {
+    neighborSkin = skin;
+    //  3x3      
+    grid = Grid(grid.type, width, height, KERNEL_RADIUS + neighborSkin);
+    lastBuildPositions.clear();
+}
+
+const Simulation::NeighborStats& Simulation::getNeighborStats() const {
+    return neighborStats;
+}
+
+void Simulation::resetNeighborStats() {
+    neighborStats.steps = 0;
+    neighborStats.rebuilds = 0;
+}
+
+void Simulation::updateNeighbors() {
+    FLUID_PROFILE_ZONE("updateNeighbors");
+    //       advanceParticles   .
+    //          
+    size_t first = std::min(grid.particleKeys.size(), particles.size());
+    grid.particleKeys.resize(particles.size());
+    for (size_t i = first; i < particles.size(); ++i) {
+        particles.x[i] = std::max(0.0f, std::min(particles.x[i], width));
+        particles.y[i] = std::max(0.0f, std::min(particles.y[i], height));
+        grid.particleKeys[i] = grid.particleKey(particles.position(i));
+    }
+
+    ++neighborStats.steps;
+    ++stepsSinceReorder;
+    if (!needsNeighborRebuild()) return;
+
+    updateGrid();
+    buildNeighborLists();
+    buildCellTasks();
+}
+
+bool Simulation::needsNeighborRebuild() const {
+    //    -   .    advanceParticles
+    return lastBuildPositions.size() != particles.size() || neighborsMoved.load();
+}
+
+void Simulation::buildNeighborLists() {
+    FLUID_PROFILE_ZONE("buildNeighborLists");
+    int count = static_cast<int>(particles.size());
+    float cutoff = KERNEL_RADIUS + neighborSkin;
+    float cutoffSq = cutoff * cutoff;
+
+    neighborStart.resize(count + 1);
+    neighborUpper.resize(count);
+    lastBuildPositions.resize(count);
+
+    //  :    
+    threadPool->parallelFor(count, PARALLEL_GRAIN, [&](int begin, int end, int) {
+        for (int i = begin; i < end; ++i) {
+            Vec2 position = particles.position(i);
+            int listLength = 0;
+            grid.forEachNeighbor(position, [&](int neighborIndex) {
+                float dx = position.x - particles.x[neighborIndex];
+                float dy = position.y - particles.y[neighborIndex];
+                if (neighborIndex != i && dx * dx + dy * dy < cutoffSq) ++listLength;
+            });
+            neighborStart[i] = listLength;
+        }
+    });
+
+    //      
+    int offset = 0;
+    maxListLength = 0;
+    for (int i = 0; i < count; ++i) {
+        int listLength = neighborStart[i];
+        neighborStart[i] = offset;
+        offset += listLength;
+        maxListLength = std::max(maxListLength, listLength);
     }
+    neighborStart[count] = offset;
+    neighborList.resize(offset);
+
+    //  :  ,       
+    threadPool->parallelFor(count, PARALLEL_GRAIN, [&](int begin, int end, int) {
+        for (int i = begin; i < end; ++i) {
+            Vec2 position = particles.position(i);
+            int cursor = neighborStart[i];
+            grid.forEachNeighbor(position, [&](int neighborIndex) {
+                if (neighborIndex == i) return; //      
+                float dx = position.x - particles.x[neighborIndex];
+                float dy = position.y - particles.y[neighborIndex];
+                if (dx * dx + dy * dy < cutoffSq) {
+                    neighborList[cursor++] = neighborIndex;
+                }
+            });
+
+            //            
+            auto first = neighborList.begin() + neighborStart[i];
+            auto last = neighborList.begin() + neighborStart[i + 1];
+            std::sort(first, last);
+            neighborUpper[i] = static_cast<int>(std::upper_bound(first, last, i) - neighborList.begin());
+            lastBuildPositions[i] = position;
+        }
+    });
+
+    neighborsMoved.store(false);
+    ++neighborStats.rebuilds;
+    neighborStats.averageListLength = count > 0 ? static_cast<float>(neighborList.size()) / count : 0.0f;
+}
+
+void Simulation::buildCellTasks() {
+    FLUID_PROFILE_ZONE("buildCellTasks");
+    //   -       ,      
+    int threads = threadPool->getThreadCount();
+    long long totalWeight = static_cast<long long>(neighborList.size()) + particles.size();
+    long long targetWeight = std::max(1LL, totalWeight / (threads * TASKS_PER_THREAD));
+
+    cellTasks.clear();
+    int taskBegin = 0;
+    long long taskWeight = 0;
+    for (size_t c = 0; c < grid.cellStart.size(); ++c) {
+        for (int k = grid.cellStart[c]; k < grid.cellEnd[c]; ++k) {
+            int i = grid.particleIndices[k];
+            taskWeight += neighborStart[i + 1] - neighborStart[i] + 1;
+        }
+        if (taskWeight >= targetWeight) {
+            cellTasks.push_back({ taskBegin, grid.cellEnd[c] });
+            taskBegin = grid.cellEnd[c];
+            taskWeight = 0;
+        }
+    }
+    if (taskBegin < static_cast<int>(particles.size())) {
+        cellTasks.push_back({ taskBegin, static_cast<int>(particles.size()) });
+    }
+}
+
+std::vector<ThreadPool::WorkerStats> Simulation::getWorkerStats() const {
+    return threadPool->getWorkerStats();
+}
+
+void Simulation::resetWorkerStats() {
+    threadPool->resetWorkerStats();
 }
 
 void Simulation::updateGrid() {
-    grid.clear();
-    for (int i = 0; i < particles.size(); ++i) {
-        //      
-        particles[i].position.x = std::max(0.0f, std::min(particles[i].position.x, 1024.0f));
-        particles[i].position.y = std::max(0.0f, std::min(particles[i].position.y, 768.0f));
-        grid.addParticle(i, particles[i].position);
+    FLUID_PROFILE_ZONE("updateGrid");
+    grid.buildFromKeys();
+
+    if (needsReorder()) {
+        reorderParticles();
     }
 }
 
+void Simulation::setReorderInterval(int steps) {
+    reorderInterval = steps;
+    stepsSinceReorder = 0;
+}
+
+bool Simulation::needsReorder() const {
+    if (reorderInterval == 0 || particles.size() < 2) return false;
+    if (reorderInterval > 0) return stepsSinceReorder >= reorderInterval;
+
+    //  :      ,   
+    int disorder = 0;
+    for (size_t i = 1; i < particles.size(); ++i) {
+        if (grid.mortonCode(grid.particleCells[i]) < grid.mortonCode(grid.particleCells[i - 1])) {
+            ++disorder;
+        }
+    }
+    return disorder > REORDER_DISORDER_THRESHOLD * particles.size();
+}
+
+void Simulation::reorderParticles() {
+    FLUID_PROFILE_ZONE("reorderParticles");
+    //   ,        
+    grid.sortCellsByMorton();
+    reorderOrder.clear();
+    for (int cellIndex : grid.mortonOrder) {
+        for (int k = grid.cellStart[cellIndex]; k < grid.cellEnd[cellIndex]; ++k) {
+            reorderOrder.push_back(grid.particleIndices[k]);
+        }
+    }
+    particles.permute(reorderOrder, reorderBuffer);
+
+    //        -  
+    grid.build(particles);
+    stepsSinceReorder = 0;
+}
+
 void Simulation::updateDensity() {
-    if (particles.empty()) return;
-
-    for (int i = 0; i < particles.size(); ++i) {
-        auto& p = particles[i];
-        p.density = 0.0f;
-
-        auto neighbors = grid.getNeighbors(p.position);
-        for (int neighborIndex : neighbors) {
-            const auto& neighbor = particles[neighborIndex];
-            float distance = std::hypot(p.position.x - neighbor.position.x, p.position.y - neighbor.position.y);
-            if (distance < KERNEL_RADIUS) {
-                p.density += kernel(distance, KERNEL_RADIUS);
+    FLUID_PROFILE_ZONE("updateDensity");
+    FLUID_PROFILE_COUNTER("particles", particles.size());
+    FLUID_PROFILE_COUNTER("pairs", neighborList.size());
+    if (pairCacheEnabled) {
+        updateDensityWithPairCache();
+        return;
+    }
+
+    SphParticleArrays arrays = particleArrays();
+
+    threadPool->parallelTasks(cellTasks, [&](int begin, int end, int) {
+        for (int cellSlot = begin; cellSlot < end; ++cellSlot) {
+            int i = grid.particleIndices[cellSlot];
+            //     -       
+            int first = neighborStart[i];
+            particles.density[i] = selfDensity
+                + sphKernels.densitySum(arrays, i, neighborList.data() + first, neighborStart[i + 1] - first, kernelParams);
+        }
+    });
+}
+
+void Simulation::updateDensityWithPairCache() {
+    int count = static_cast<int>(particles.size());
+    pairCache.resize(neighborList.size());
+    pairCount.resize(count);
+    pairUpper.resize(count);
+    SphParticleArrays arrays = particleArrays();
+
+    threadPool->parallelTasks(cellTasks, [&](int begin, int end, int) {
+        for (int cellSlot = begin; cellSlot < end; ++cellSlot) {
+            int i = grid.particleIndices[cellSlot];
+            //        -  ,      
+            int first = neighborStart[i];
+            int upper = neighborUpper[i];
+            int lowerPairs = 0, upperPairs = 0;
+            PairEntry* pairs = pairCache.data() + first;
+            float density = pairCacheKernels.densityEmit(arrays, i, neighborList.data() + first, upper - first, pairs, lowerPairs);
+            density += pairCacheKernels.densityEmit(arrays, i, neighborList.data() + upper, neighborStart[i + 1] - upper,
+                pairs + lowerPairs, upperPairs);
+            particles.density[i] = selfDensity + density;
+            pairCount[i] = lowerPairs + upperPairs;
+            pairUpper[i] = first + lowerPairs;
+        }
+    });
+}
+
+void Simulation::setEquationOfState(EquationOfState eos) {
+    equationOfState = eos;
+}
+
+Simulation::EquationOfState Simulation::getEquationOfState() const {
+    return equationOfState;
+}
+
+void Simulation::setStiffness(float value) {
+    stiffness = value;
+}
+
+float Simulation::getStiffness() const {
+    return stiffness;
+}
+
+void Simulation::updatePressure() {
+    FLUID_PROFILE_ZONE("updatePressure");
+    FLUID_PROFILE_COUNTER("particles", particles.size());
+    //        -      ,    
+    threadPool->parallelFor(static_cast<int>(particles.size()), PARALLEL_GRAIN, [&](int begin, int end, int) {
+        if (equationOfState == EquationOfState::Tait) {
+            float scale = stiffness * REST_DENSITY / TAIT_EXPONENT;
+            for (int i = begin; i < end; ++i) {
+                particles.pressure[i] = scale * (std::pow(particles.density[i] / REST_DENSITY, TAIT_EXPONENT) - 1.0f);
             }
         }
-    }
+        else {
+            for (int i = begin; i < end; ++i) {
+                particles.pressure[i] = stiffness * (particles.density[i] - REST_DENSITY);
+            }
+        }
+    });
+}
+
+void Simulation::setSymmetricForces(bool enabled) {
+    symmetricForces = enabled;
+}
+
+void Simulation::setPairCache(bool enabled) {
+    pairCacheEnabled = enabled;
+}
+
+size_t Simulation::getPairCacheBytes() const {
+    return pairCache.capacity() * sizeof(PairEntry) + (pairCount.capacity() + pairUpper.capacity()) * sizeof(int);
 }
 
-void Simulation::updateForces(float dt) {
-    for (int i = 0; i < particles.size(); ++i) {
-        auto& p = particles[i];
-        sf::Vector2f pressureForce = { 0.0f, 0.0f };
-        sf::Vector2f viscosityForce = { 0.0f, 0.0f };
+void Simulation::updateForces() {
+    FLUID_PROFILE_ZONE("updateForces");
+    FLUID_PROFILE_COUNTER("particles", particles.size());
+    FLUID_PROFILE_COUNTER("pairs", symmetricForces && !deterministic ? neighborList.size() / 2 : neighborList.size());
+    //   :   fx  fy       
+    pairScratch.resize(threadPool->getThreadCount());
+    for (auto& scratch : pairScratch) scratch.resize(2 * static_cast<size_t>(maxListLength));
+
+    if (symmetricForces && !deterministic) {
+        updateForcesSymmetric();
+    }
+    else {
+        //             
+        forceAccumulators.resize(1);
+        auto& forces = forceAccumulators[0];
+        forces.resize(particles.size());
+        SphParticleArrays arrays = particleArrays();
+        threadPool->parallelTasks(cellTasks, [&](int begin, int end, int thread) {
+            float* fx = pairScratch[thread].data();
+            float* fy = fx + maxListLength;
+            for (int cellSlot = begin; cellSlot < end; ++cellSlot) {
+                int i = grid.particleIndices[cellSlot];
+                int first = neighborStart[i];
+                int count;
+                if (pairCacheEnabled) {
+                    count = pairCount[i];
+                    pairCacheKernels.pairForces(arrays, i, pairCache.data() + first, count, kernelParams, fx, fy);
+                }
+                else {
+                    count = neighborStart[i + 1] - first;
+                    sphKernels.pairForces(arrays, i, neighborList.data() + first, count, kernelParams, fx, fy);
+                }
 
-        auto neighbors = grid.getNeighbors(p.position);
-        for (int neighborIndex : neighbors) {
-            if (neighborIndex == i) continue; //    
+                //       
+                Vec2 force = { 0.0f, 0.0f };
+                for (int n = 0; n < count; ++n) {
+                    force.x += fx[n];
+                    force.y += fy[n];
+                }
+                forces[i] = force;
+            }
+        });
+    }
+}
 
-            const auto& neighbor = particles[neighborIndex];
-            sf::Vector2f r = p.position - neighbor.position;
-            float distance = std::hypot(r.x, r.y);
+void Simulation::updateForcesSymmetric() {
+    int count = static_cast<int>(particles.size());
+    forceAccumulators.resize(threadPool->getThreadCount());
+    for (auto& forces : forceAccumulators) forces.resize(count);
 
-            if (distance < KERNEL_RADIUS) {
-                // 
-                float pressure = PRESSURE_CONSTANT * (p.density + neighbor.density - 2 * REST_DENSITY);
-                pressureForce += kernelGradient(r, KERNEL_RADIUS) * pressure;
+    //        
+    threadPool->parallelFor(count, PARALLEL_GRAIN, [&](int begin, int end, int) {
+        for (auto& forces : forceAccumulators) {
+            std::fill(forces.begin() + begin, forces.begin() + end, Vec2{ 0.0f, 0.0f });
+        }
+    });
 
-                // 
-                viscosityForce += (neighbor.velocity - p.velocity) * VISCOSITY_CONSTANT * kernel(distance, KERNEL_RADIUS);
+    threadPool->parallelTasks(cellTasks, [&](int begin, int end, int thread) {
+        accumulatePairForces(begin, end, forceAccumulators[thread], pairScratch[thread]);
+    });
+}
+
+void Simulation::advanceParticles(float dt) {
+    FLUID_PROFILE_ZONE("advanceParticles");
+    FLUID_PROFILE_COUNTER("particles", particles.size());
+    //     :  ->  ->  ->  ->  
+    //          
+    float maxDisplacement = neighborSkin * 0.5f;
+    float maxDisplacementSq = maxDisplacement * maxDisplacement;
+    motionLimits.assign(threadPool->getThreadCount(), MotionLimits());
+    threadPool->parallelFor(static_cast<int>(particles.size()), PARALLEL_GRAIN, [&](int begin, int end, int thread) {
+        bool moved = false;
+        MotionLimits limits = motionLimits[thread];
+        for (int i = begin; i < end; ++i) {
+            //      
+            Vec2 pairForce = { 0.0f, 0.0f };
+            for (const auto& forces : forceAccumulators) {
+                pairForce += forces[i];
             }
+
+            // 
+            Vec2 gravityForce = { 0.0f, GRAVITY * particles.density[i] };
+
+            //  
+            Vec2 totalForce = pairForce + gravityForce;
+            particles.vx[i] += totalForce.x * dt;
+            particles.vy[i] += totalForce.y * dt;
+            limits.maxAccelerationSq = std::max(limits.maxAccelerationSq, totalForce.x * totalForce.x + totalForce.y * totalForce.y);
+            limits.maxSpeedSq = std::max(limits.maxSpeedSq, particles.vx[i] * particles.vx[i] + particles.vy[i] * particles.vy[i]);
+
+            //     
+            particles.x[i] += particles.vx[i] * dt;
+            particles.y[i] += particles.vy[i] * dt;
+            handleBoundaryCollision(particles.x[i], particles.y[i], particles.vx[i], particles.vy[i]);
+
+            Vec2 position = particles.position(i);
+            grid.particleKeys[i] = grid.particleKey(position);
+            Vec2 d = position - lastBuildPositions[i];
+            moved |= d.x * d.x + d.y * d.y > maxDisplacementSq;
         }
+        if (moved) neighborsMoved.store(true, std::memory_order_relaxed);
+        motionLimits[thread] = limits;
+    });
+}
 
-        // 
-        sf::Vector2f gravityForce = { 0.0f, GRAVITY * p.density };
+//     grid.particleIndices[begin, end)      
+void Simulation::accumulatePairForces(int begin, int end, std::vector<Vec2>& forces, std::vector<float>& scratch) const {
+    SphParticleArrays arrays = particleArrays();
+    float* fx = scratch.data();
+    float* fy = fx + maxListLength;
+    for (int cellSlot = begin; cellSlot < end; ++cellSlot) {
+        int i = grid.particleIndices[cellSlot];
+        int first, count;
+        if (pairCacheEnabled) {
+            first = pairUpper[i];
+            count = neighborStart[i] + pairCount[i] - first;
+            pairCacheKernels.pairForces(arrays, i, pairCache.data() + first, count, kernelParams, fx, fy);
+        }
+        else {
+            first = neighborUpper[i];
+            count = neighborStart[i + 1] - first;
+            sphKernels.pairForces(arrays, i, neighborList.data() + first, count, kernelParams, fx, fy);
+        }
 
-        //  
-        sf::Vector2f totalForce = pressureForce + viscosityForce + gravityForce;
+        //       i  j
+        Vec2 force = { 0.0f, 0.0f };
+        for (int n = 0; n < count; ++n) {
+            int j = pairCacheEnabled ? pairCache[first + n].neighbor : neighborList[first + n];
+            force.x += fx[n];
+            force.y += fy[n];
+            forces[j].x -= fx[n];
+            forces[j].y -= fy[n];
+        }
+        forces[i] += force;
+    }
+}
+
+void Simulation::handleBoundaryCollision(float& x, float& y, float& vx, float& vy) const {
+    //      
+    x = std::max(0.0f, std::min(x, width));
+    y = std::max(0.0f, std::min(y, height));
 
-        //  
-        p.velocity += totalForce * dt;
+    //    
+    if (x < PARTICLE_RADIUS) {
+        x = PARTICLE_RADIUS;
+        vx *= -BOUNDARY_DAMPING;
     }
+    //    
+    if (x > width - PARTICLE_RADIUS) {
+        x = width - PARTICLE_RADIUS;
+        vx *= -BOUNDARY_DAMPING;
+    }
+    //    
+    if (y < PARTICLE_RADIUS) {
+        y = PARTICLE_RADIUS;
+        vy *= -BOUNDARY_DAMPING;
+    }
+    //    
+    if (y > height - PARTICLE_RADIUS) {
+        y = height - PARTICLE_RADIUS;
+        vy *= -BOUNDARY_DAMPING;
+    }
+}
+void Simulation::predictPositions(float dt) {
+    FLUID_PROFILE_ZONE("predictPositions");
+    FLUID_PROFILE_COUNTER("particles", particles.size());
+    // ,   ,   advanceParticles.     
+    //    :       
+    float maxDisplacement = neighborSkin * 0.5f;
+    float maxDisplacementSq = maxDisplacement * maxDisplacement;
+    bool checkMoved = lastBuildPositions.size() == particles.size(); //     
+    grid.particleKeys.resize(particles.size());
+    threadPool->parallelFor(static_cast<int>(particles.size()), PARALLEL_GRAIN, [&](int begin, int end, int) {
+        bool moved = false;
+        for (int i = begin; i < end; ++i) {
+            particles.vy[i] += GRAVITY_ACCELERATION * dt;
+            particles.x[i] += particles.vx[i] * dt;
+            particles.y[i] += particles.vy[i] * dt;
+            handleBoundaryCollision(particles.x[i], particles.y[i], particles.vx[i], particles.vy[i]);
+
+            Vec2 position = particles.position(i);
+            grid.particleKeys[i] = grid.particleKey(position);
+            if (checkMoved) {
+                Vec2 d = position - lastBuildPositions[i];
+                moved |= d.x * d.x + d.y * d.y > maxDisplacementSq;
+            }
+        }
+        if (moved) neighborsMoved.store(true, std::memory_order_relaxed);
+    });
 }
 
-void Simulation::integrate(float dt) {
-    for (auto& p : particles) {
-        p.position += p.velocity * dt;
+void Simulation::solveDensityConstraints() {
+    FLUID_PROFILE_ZONE("solveDensityConstraints");
+    FLUID_PROFILE_COUNTER("particles", particles.size());
+    FLUID_PROFILE_COUNTER("iterations", solverIterations);
+    //     updateNeighbors:    
+    int count = static_cast<int>(particles.size());
+    predictedX = particles.x;
+    predictedY = particles.y;
+    constraintLambda.resize(count);
+    correctionX.resize(count);
+    correctionY.resize(count);
+    SphParticleArrays arrays = particleArrays();
+    const IncompressibleKernels& kernels = incompressibleKernels;
+
+    for (int iteration = 0; iteration < solverIterations; ++iteration) {
+        threadPool->parallelTasks(cellTasks, [&](int begin, int end, int) {
+            for (int cellSlot = begin; cellSlot < end; ++cellSlot) {
+                int i = grid.particleIndices[cellSlot];
+                int first = neighborStart[i];
+                constraintLambda[i] = kernels.constraintLambda(arrays, i, neighborList.data() + first, neighborStart[i + 1] - first,
+                    kernels.restDensity, kernels.relaxation, particles.density[i]);
+            }
+        });
+
+        threadPool->parallelTasks(cellTasks, [&](int begin, int end, int) {
+            for (int cellSlot = begin; cellSlot < end; ++cellSlot) {
+                int i = grid.particleIndices[cellSlot];
+                int first = neighborStart[i];
+                kernels.positionCorrection(arrays, constraintLambda.data(), i, neighborList.data() + first, neighborStart[i + 1] - first,
+                    kernels.restDensity, correctionX[i], correctionY[i]);
+            }
+        });
+
+        //    ,       
+        threadPool->parallelFor(count, PARALLEL_GRAIN, [&](int begin, int end, int) {
+            for (int i = begin; i < end; ++i) {
+                particles.x[i] = std::max(PARTICLE_RADIUS, std::min(particles.x[i] + correctionX[i], width - PARTICLE_RADIUS));
+                particles.y[i] = std::max(PARTICLE_RADIUS, std::min(particles.y[i] + correctionY[i], height - PARTICLE_RADIUS));
+            }
+        });
     }
 }
 
-void Simulation::handleBoundaryCollisions() {
-    for (auto& p : particles) {
-        //      
-        p.position.x = std::max(0.0f, std::min(p.position.x, 1024.0f));
-        p.position.y = std::max(0.0f, std::min(p.position.y, 768.0f));
+void Simulation::updatePositionBasedVelocities(float dt) {
+    FLUID_PROFILE_ZONE("updatePositionBasedVelocities");
+    FLUID_PROFILE_COUNTER("particles", particles.size());
+    //     predictPositions  ,  
+    int count = static_cast<int>(particles.size());
+    float inverseDt = 1.0f / dt;
+    threadPool->parallelFor(count, PARALLEL_GRAIN, [&](int begin, int end, int) {
+        for (int i = begin; i < end; ++i) {
+            particles.vx[i] += (particles.x[i] - predictedX[i]) * inverseDt;
+            particles.vy[i] += (particles.y[i] - predictedY[i]) * inverseDt;
+        }
+    });
+
+    applyXsphViscosity();
+}
+
+void Simulation::applyXsphViscosity() {
+    //          
+    int count = static_cast<int>(particles.size());
+    correctionX.resize(count);
+    correctionY.resize(count);
+    SphParticleArrays arrays = particleArrays();
+    threadPool->parallelTasks(cellTasks, [&](int begin, int end, int) {
+        for (int cellSlot = begin; cellSlot < end; ++cellSlot) {
+            int i = grid.particleIndices[cellSlot];
+            int first = neighborStart[i];
+            incompressibleKernels.xsphVelocity(arrays, i, neighborList.data() + first, neighborStart[i + 1] - first,
+                XSPH_VISCOSITY, correctionX[i], correctionY[i]);
+        }
+    });
+    threadPool->parallelFor(count, PARALLEL_GRAIN, [&](int begin, int end, int) {
+        for (int i = begin; i < end; ++i) {
+            particles.vx[i] += correctionX[i];
+            particles.vy[i] += correctionY[i];
+        }
+    });
+}
+
+void Simulation::computeDivergenceFactors() {
+    FLUID_PROFILE_ZONE("computeDivergenceFactors");
+    FLUID_PROFILE_COUNTER("particles", particles.size());
+    divergenceFactor.resize(particles.size());
+    SphParticleArrays arrays = particleArrays();
+    const IncompressibleKernels& kernels = incompressibleKernels;
+    float minDenominator = DFSPH_FACTOR_EPSILON * kernels.restGradientSq;
+    threadPool->parallelTasks(cellTasks, [&](int begin, int end, int) {
+        for (int cellSlot = begin; cellSlot < end; ++cellSlot) {
+            int i = grid.particleIndices[cellSlot];
+            int first = neighborStart[i];
+            divergenceFactor[i] = kernels.divergenceFactor(arrays, i, neighborList.data() + first, neighborStart[i + 1] - first,
+                minDenominator, particles.density[i]);
+        }
+    });
+}
+
+//      DFSPH.   -     
+// : max(dt * D rho_i / Dt, 0)  , max(rho_i + dt * D rho_i / Dt - rho_0, 0)
+//  .  kappa_i = error_i * alpha_i / dt^2  ,   .
+// kappa          .
+//      ,       
+// ,   ,       
+int Simulation::solvePressure(std::vector<float>& kappa, bool densityError, float dt, float& averageError, float& maxError) {
+    FLUID_PROFILE_ZONE(densityError ? "solveDensity" : "solveDivergence");
+    int count = static_cast<int>(particles.size());
+    kappaIncrement.resize(count);
+    SphParticleArrays arrays = particleArrays();
+    const IncompressibleKernels& kernels = incompressibleKernels;
+    float inverseDtSq = 1.0f / (dt * dt);
+    float maxVelocityChange = neighborSkin * 0.5f / dt; //        skin / 2
+    velocityBeforeSolveX = particles.vx;
+    velocityBeforeSolveY = particles.vy;
+    velocityLimited.assign(count, 0);
+
+    auto particleError = [&](int i) {
+        int first = neighborStart[i];
+        float rate = kernels.densityChangeRate(arrays, i, neighborList.data() + first, neighborStart[i + 1] - first);
+        float offset = densityError ? particles.density[i] - kernels.restDensity : 0.0f;
+        return std::max(offset + dt * rate, 0.0f);
+    };
+
+    // v_i += dt * a_i(values).      values,    .
+    // ,    ,          / dt.
+    //    PBF,     :     .
+    //          kappa     
+    auto applyKappa = [&](const std::vector<float>& values, bool accumulate) {
+        threadPool->parallelTasks(cellTasks, [&](int begin, int end, int) {
+            for (int cellSlot = begin; cellSlot < end; ++cellSlot) {
+                int i = grid.particleIndices[cellSlot];
+                int first = neighborStart[i];
+                float ax, ay;
+                kernels.pressureAcceleration(arrays, values.data(), i, neighborList.data() + first, neighborStart[i + 1] - first, ax, ay);
+                particles.vx[i] += dt * ax;
+                particles.vy[i] += dt * ay;
+                float changeX = particles.vx[i] - velocityBeforeSolveX[i];
+                float changeY = particles.vy[i] - velocityBeforeSolveY[i];
+                float changeSq = changeX * changeX + changeY * changeY;
+                if (changeSq > maxVelocityChange * maxVelocityChange) {
+                    float scale = maxVelocityChange / std::sqrt(changeSq);
+                    particles.vx[i] = velocityBeforeSolveX[i] + changeX * scale;
+                    particles.vy[i] = velocityBeforeSolveY[i] + changeY * scale;
+                    velocityLimited[i] = 1;
+                }
+                constrainWallVelocity(i);
+                if (accumulate) kappa[i] += values[i];
+            }
+        });
+    };
 
-        //    
-        if (p.position.x < PARTICLE_RADIUS) {
-            p.position.x = PARTICLE_RADIUS;
-            p.velocity.x *= -BOUNDARY_DAMPING;
+    //  :  kappa    ,    .
+    //        
+    threadPool->parallelTasks(cellTasks, [&](int begin, int end, int) {
+        for (int cellSlot = begin; cellSlot < end; ++cellSlot) {
+            int i = grid.particleIndices[cellSlot];
+            kappa[i] = particleError(i) <= 0.0f ? 0.0f : 0.5f * kappa[i];
         }
-        //    
-        if (p.position.x > 1024 - PARTICLE_RADIUS) {
-            p.position.x = 1024 - PARTICLE_RADIUS;
-            p.velocity.x *= -BOUNDARY_DAMPING;
+    });
+    applyKappa(kappa, false);
+
+    //         ,     :
+    //      ,      
+    particleErrors.resize(count);
+    errorSums.resize((count + PARALLEL_GRAIN - 1) / PARALLEL_GRAIN);
+    int iterations = 0;
+    while (true) {
+        threadPool->parallelTasks(cellTasks, [&](int begin, int end, int) {
+            for (int cellSlot = begin; cellSlot < end; ++cellSlot) {
+                int i = grid.particleIndices[cellSlot];
+                float error = velocityLimited[i] ? 0.0f : particleError(i);
+                kappaIncrement[i] = error * divergenceFactor[i] * inverseDtSq;
+                particleErrors[i] = error;
+            }
+        });
+        threadPool->parallelFor(count, PARALLEL_GRAIN, [&](int begin, int end, int) {
+            //        ,    
+            for (int chunk = begin; chunk < end; chunk += PARALLEL_GRAIN) {
+                int chunkEnd = std::min(chunk + PARALLEL_GRAIN, end);
+                double sum = 0.0;
+                float maximum = 0.0f;
+                for (int i = chunk; i < chunkEnd; ++i) {
+                    sum += particleErrors[i];
+                    maximum = std::max(maximum, particleErrors[i]);
+                }
+                errorSums[chunk / PARALLEL_GRAIN].value = sum;
+                errorSums[chunk / PARALLEL_GRAIN].maximum = maximum;
+            }
+        });
+
+        double totalError = 0.0;
+        float maximum = 0.0f;
+        for (const auto& sum : errorSums) {
+            totalError += sum.value;
+            maximum = std::max(maximum, sum.maximum);
         }
-        //    
-        if (p.position.y < PARTICLE_RADIUS) {
-            p.position.y = PARTICLE_RADIUS;
-            p.velocity.y *= -BOUNDARY_DAMPING;
+        averageError = count > 0 ? static_cast<float>(totalError / count / kernels.restDensity) : 0.0f;
+        maxError = maximum / kernels.restDensity;
+        bool converged = averageError <= densityErrorTolerance && maxError <= DFSPH_MAX_ERROR_RATIO * densityErrorTolerance;
+        if (converged || iterations == maxSolverIterations) break;
+
+        applyKappa(kappaIncrement, true);
+        ++iterations;
+    }
+    FLUID_PROFILE_COUNTER("iterations", iterations);
+    return iterations;
+}
+
+void Simulation::applyNonPressureForces(float dt) {
+    FLUID_PROFILE_ZONE("applyNonPressureForces");
+    threadPool->parallelFor(static_cast<int>(particles.size()), PARALLEL_GRAIN, [&](int begin, int end, int) {
+        for (int i = begin; i < end; ++i) {
+            particles.vy[i] += GRAVITY_ACCELERATION * dt;
+            constrainWallVelocity(i);
         }
-        //    
-        if (p.position.y > 768 - PARTICLE_RADIUS) {
-            p.position.y = 768 - PARTICLE_RADIUS;
-            p.velocity.y *= -BOUNDARY_DAMPING;
+    });
+    applyXsphViscosity();
+}
+
+void Simulation::advancePositions(float dt) {
+    FLUID_PROFILE_ZONE("advancePositions");
+    FLUID_PROFILE_COUNTER("particles", particles.size());
+    // , ,      -    advanceParticles
+    float maxDisplacement = neighborSkin * 0.5f;
+    float maxDisplacementSq = maxDisplacement * maxDisplacement;
+    motionLimits.assign(threadPool->getThreadCount(), MotionLimits());
+    threadPool->parallelFor(static_cast<int>(particles.size()), PARALLEL_GRAIN, [&](int begin, int end, int thread) {
+        bool moved = false;
+        MotionLimits limits = motionLimits[thread];
+        for (int i = begin; i < end; ++i) {
+            limits.maxSpeedSq = std::max(limits.maxSpeedSq, particles.vx[i] * particles.vx[i] + particles.vy[i] * particles.vy[i]);
+            particles.x[i] += particles.vx[i] * dt;
+            particles.y[i] += particles.vy[i] * dt;
+            handleBoundaryCollision(particles.x[i], particles.y[i], particles.vx[i], particles.vy[i]);
+
+            Vec2 position = particles.position(i);
+            grid.particleKeys[i] = grid.particleKey(position);
+            Vec2 d = position - lastBuildPositions[i];
+            moved |= d.x * d.x + d.y * d.y > maxDisplacementSq;
         }
+        if (moved) neighborsMoved.store(true, std::memory_order_relaxed);
+        motionLimits[thread] = limits;
+    });
+}
+
+void Simulation::constrainWallVelocity(int i) {
+    //       :   ,   
+    //  ,      
+    if ((particles.x[i] <= PARTICLE_RADIUS && particles.vx[i] < 0.0f) || (particles.x[i] >= width - PARTICLE_RADIUS && particles.vx[i] > 0.0f)) {
+        particles.vx[i] = 0.0f;
     }
-}
\ No newline at end of file
+    if ((particles.y[i] <= PARTICLE_RADIUS && particles.vy[i] < 0.0f) || (particles.y[i] >= height - PARTICLE_RADIUS && particles.vy[i] > 0.0f)) {
+        particles.vy[i] = 0.0f;
+    }
+}
@@ -0,0 +1,57 @@
+#include "SimulationThread.h"
+#include <algorithm>
+#include <chrono>
+
+constexpr double MAX_LAG = 0.25; // ,      
+
+static double now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+SimulationThread::SimulationThread(Simulation& simulation, float step) : simulation(simulation), step(step) {
+    thread = std::thread(&SimulationThread::run, this);
+}
+
+SimulationThread::~SimulationThread() {
+    stopping = true;
+    thread.join();
+}
+
+void SimulationThread::pushInput(const MouseInput& mouse) {
+    input.push(mouse);
+}
+
+const ParticleSnapshot& SimulationThread::acquireSnapshot() {
+    snapshots.update();
+    return snapshots.front();
+}
+
+float SimulationThread::interpolationAlpha(const ParticleSnapshot& snapshot) const {
+    return static_cast<float>(std::clamp((now() - snapshot.time) / step, 0.0, 1.0));
+}
+
+void SimulationThread::run() {
+    MouseInput mouse;
+    double nextStep = now();
+    while (!stopping) {
+        //        
+        MouseInput pending;
+        while (input.pop(pending)) mouse = pending;
+
+        simulation.update(step, mouse.leftPressed, mouse.position);
+
+        //    front,     
+        snapshots.back().assign(simulation.getParticles(), now());
+        snapshots.publish();
+
+        //     :    
+        nextStep += step;
+        double current = now();
+        if (current < nextStep) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(nextStep - current));
+        }
+        else if (current - nextStep > MAX_LAG) {
+            nextStep = current;
+        }
+    }
+}
@@ -0,0 +1,173 @@
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+
+static uint64_t packRange(uint32_t head, uint32_t tail) {
+    return (static_cast<uint64_t>(head) << 32) | tail;
+}
+
+ThreadPool::ThreadPool(int threadCount) : queues(std::max(threadCount, 1)), workerStats(std::max(threadCount, 1)) {
+    for (int t = 1; t < std::max(threadCount, 1); ++t) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, t);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+int ThreadPool::getThreadCount() const {
+    return static_cast<int>(workers.size()) + 1;
+}
+
+std::vector<ThreadPool::WorkerStats> ThreadPool::getWorkerStats() const {
+    std::vector<WorkerStats> result;
+    for (const auto& padded : workerStats) result.push_back(padded.stats);
+    return result;
+}
+
+void ThreadPool::resetWorkerStats() {
+    for (auto& padded : workerStats) padded.stats = WorkerStats();
+}
+
+void ThreadPool::run(int count, int grainSize, const Task* tasks, int taskCount, JobFunction function, void* context) {
+    grainSize = std::max(grainSize, 1);
+
+    if (tasks == nullptr) {
+        if (count <= 0) return;
+        //     ,   
+        if (workers.empty() || count <= grainSize) {
+            jobFunction = function;
+            jobContext = context;
+            execute(0, count, 0, false);
+            return;
+        }
+    }
+    else {
+        if (taskCount <= 0) return;
+        //  :        
+        int threads = getThreadCount();
+        for (int t = 0; t < threads; ++t) {
+            uint32_t head = static_cast<uint32_t>(static_cast<long long>(taskCount) * t / threads);
+            uint32_t tail = static_cast<uint32_t>(static_cast<long long>(taskCount) * (t + 1) / threads);
+            queues[t].range.store(packRange(head, tail), std::memory_order_relaxed);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobFunction = function;
+        jobContext = context;
+        jobTasks = tasks;
+        jobCount = count;
+        jobGrain = grainSize;
+        jobChunks = (count + grainSize - 1) / grainSize;
+        nextChunk.store(0, std::memory_order_relaxed);
+        activeWorkers = static_cast<int>(workers.size());
+        ++generation;
+    }
+    if (!workers.empty()) wakeCondition.notify_all();
+
+    runJob(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCondition.wait(lock, [this] { return activeWorkers == 0; });
+    jobFunction = nullptr;
+    jobContext = nullptr;
+    jobTasks = nullptr;
+}
+
+void ThreadPool::workerLoop(int thread) {
+    unsigned seenGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeCondition.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) return;
+            seenGeneration = generation;
+        }
+
+        {
+            FLUID_PROFILE_ZONE("ThreadPool::job");
+            runJob(thread);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--activeWorkers == 0) doneCondition.notify_one();
+    }
+}
+
+void ThreadPool::runJob(int thread) {
+    if (jobTasks != nullptr) {
+        runTasks(thread);
+    }
+    else {
+        runChunks(thread);
+    }
+}
+
+void ThreadPool::runChunks(int thread) {
+    //   ,      
+    for (int chunk = nextChunk.fetch_add(1); chunk < jobChunks; chunk = nextChunk.fetch_add(1)) {
+        int begin = chunk * jobGrain;
+        int end = std::min(begin + jobGrain, jobCount);
+        execute(begin, end, thread, false);
+    }
+}
+
+void ThreadPool::runTasks(int thread) {
+    int task;
+    //      -      
+    while (popTask(thread, false, task)) {
+        execute(jobTasks[task].begin, jobTasks[task].end, thread, false);
+    }
+
+    //      ,      .
+    //    ,      
+    int threads = getThreadCount();
+    bool found = true;
+    while (found) {
+        found = false;
+        for (int offset = 1; offset < threads; ++offset) {
+            int victim = (thread + offset) % threads;
+            if (popTask(victim, true, task)) {
+                execute(jobTasks[task].begin, jobTasks[task].end, thread, true);
+                found = true;
+                break;
+            }
+        }
+    }
+}
+
+bool ThreadPool::popTask(int owner, bool fromBack, int& task) {
+    auto& range = queues[owner].range;
+    uint64_t current = range.load(std::memory_order_acquire);
+    while (true) {
+        uint32_t head = static_cast<uint32_t>(current >> 32);
+        uint32_t tail = static_cast<uint32_t>(current);
+        if (head >= tail) return false;
+
+        uint64_t next = fromBack ? packRange(head, tail - 1) : packRange(head + 1, tail);
+        if (range.compare_exchange_weak(current, next, std::memory_order_acq_rel)) {
+            task = static_cast<int>(fromBack ? tail - 1 : head);
+            return true;
+        }
+    }
+}
+
+void ThreadPool::execute(int begin, int end, int thread, bool stolen) {
+    auto start = std::chrono::steady_clock::now();
+    jobFunction(jobContext, begin, end, thread);
+
+    //       ,   -
+    auto& stats = workerStats[thread].stats;
+    stats.busySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ++stats.tasks;
+    if (stolen) ++stats.steals;
+}
\ No newline at end of file
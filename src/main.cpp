@@ -1,13 +1,17 @@
 #include <SFML/Graphics.hpp>
 #include "Simulation.h"
+#include "SimulationThread.h"
 #include "Renderer.h"
 
+constexpr float PHYSICS_STEP = 1.0f / 60.0f; //  ,     
+
 int main() {
     sf::RenderWindow window(sf::VideoMode({ 1024, 768 }), "SPH Simulation");
     window.setFramerateLimit(60);
 
     Simulation simulation;
     Renderer renderer(window);
+    SimulationThread simulationThread(simulation, PHYSICS_STEP); //     
 
     sf::Color currentColor = sf::Color::Blue; //  
     bool isLeftMousePressed = false; //  
@@ -29,15 +33,14 @@ int main() {
             }
         }
 
-        //   
+        //        
         sf::Vector2f mousePosition = window.mapPixelToCoords(sf::Mouse::getPosition(window));
+        simulationThread.pushInput({ isLeftMousePressed, { mousePosition.x, mousePosition.y } });
 
-        //  
-        simulation.update(1.0f / 60.0f, isLeftMousePressed, mousePosition);
-
-        // 
+        //        
+        const ParticleSnapshot& snapshot = simulationThread.acquireSnapshot();
         window.clear();
-        renderer.render(simulation.getParticles());
+        renderer.render(snapshot, simulationThread.interpolationAlpha(snapshot));
         window.display();
     }
 
@@ -0,0 +1,28 @@
+# Runs fluidsim_bench in deterministic mode with one and with several threads
+# and fails if the final state checksums differ.
+# Usage: cmake -DBENCH=<fluidsim_bench> -DSOLVER=wcsph|pbf|dfsph -DTHREADS=N -P DeterminismCheck.cmake
+
+set(checksums)
+foreach(threads 1 ${THREADS})
+    execute_process(
+        COMMAND ${BENCH} --scenario dam_break --particles 3000 --steps 30 --warmup 0
+                --solver ${SOLVER} --deterministic on --threads ${threads}
+        OUTPUT_VARIABLE output
+        ERROR_QUIET
+        RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "fluidsim_bench failed with ${threads} threads: ${result}")
+    endif()
+    string(REGEX MATCH "\"checksum\": \"([0-9a-f]+)\"" match "${output}")
+    if(NOT match)
+        message(FATAL_ERROR "no checksum in the output with ${threads} threads")
+    endif()
+    message(STATUS "${SOLVER}, ${threads} threads: ${CMAKE_MATCH_1}")
+    list(APPEND checksums ${CMAKE_MATCH_1})
+endforeach()
+
+list(GET checksums 0 single)
+list(GET checksums 1 multi)
+if(NOT single STREQUAL multi)
+    message(FATAL_ERROR "${SOLVER}: checksum with 1 thread (${single}) differs from ${THREADS} threads (${multi})")
+endif()